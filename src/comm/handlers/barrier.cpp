@@ -26,6 +26,7 @@ static uint64_t micros_diff(struct timespec* t_start, struct timespec* t_end) {
 static void critical_wait(void* arg) {
 	barrier_handler_arg_t* bar_arg = (barrier_handler_arg_t*) arg;
 	bar_arg->handler->my_wait(bar_arg);
+	bar_arg->handler->n_passed += 1;
     //  Only works for n=2 nodes
 	__atomic_add_fetch(&bar_arg->handler->received, -1, __ATOMIC_SEQ_CST);
 }
@@ -33,10 +34,13 @@ static void critical_wait(void* arg) {
 BarrierHandler::BarrierHandler(Communicator* comm) : comm(comm), received(0),
 	local_barrier(Config::instance().num_txn_workers, critical_wait, true) {
     num_nodes = comm->num_nodes;
+    assert(num_nodes <= MAX_NODES);
 }
 
 //	This function is only ever called from the single network thread.
 void BarrierHandler::handle(msg::Barrier* msg) {
+	uint32_t sender = msg->sender;
+	values[sender][n_received[sender]++ & 1] = msg->value;
 	__atomic_add_fetch(&received, 1, __ATOMIC_SEQ_CST);
 }
 
@@ -52,6 +56,7 @@ void BarrierHandler::my_wait(barrier_handler_arg_t* bar_arg) {
             auto msg = pkt->ctor<msg::Barrier>();
             msg->sender = comm->node_id;
             msg->num = bar_arg->id;
+            msg->value = bar_arg->value;
             comm->send(msg::node_t{i}, pkt);
         }
 	}
@@ -59,6 +64,11 @@ void BarrierHandler::my_wait(barrier_handler_arg_t* bar_arg) {
 	while (__atomic_load_n(&received, __ATOMIC_SEQ_CST) != (comm->num_nodes-1)) {
 		__builtin_ia32_pause();
 	}
+	for (uint32_t i = 0; i < num_nodes; ++i) {
+		if (i != comm->node_id) {
+			bar_arg->value = std::max(bar_arg->value, values[i][n_passed & 1]);
+		}
+	}
 
     struct timespec ts_end;
     rc = clock_gettime(CLOCK_REALTIME, &ts_end);
@@ -112,3 +122,13 @@ void BarrierHandler::wait_nodes() {
         wait_nodes_time[WorkerContext::get().tid] += micros_diff(&ts_begin, &ts_end);
     }
 }
+
+uint32_t BarrierHandler::wait_nodes(uint32_t value) {
+	barrier_handler_arg_t arg;
+	arg.handler = this;
+    arg.id = __atomic_fetch_add(&id_ctr, 1, __ATOMIC_SEQ_CST);
+    arg.value = value;
+	critical_wait(&arg);
+    __sync_synchronize();
+    return arg.value;
+}
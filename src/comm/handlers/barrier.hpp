@@ -13,6 +13,7 @@ struct BarrierHandler;
 struct barrier_handler_arg_t {
 	BarrierHandler* handler;
     uint32_t id;
+    uint32_t value = 0; // sent along, the max over all nodes once through
 };
 
 struct queued_msg_t {
@@ -29,10 +30,19 @@ struct BarrierHandler {
 	reusable_barrier_t local_barrier;
 	std::queue<queued_msg_t> q;
 
+	/*	the value of each node's last two barriers. A node can be at most one barrier ahead of
+		this one, so slot n & 1 of the n-th barrier is not overwritten before it is read. */
+	static constexpr size_t MAX_NODES = 16;
+	uint32_t values[MAX_NODES][2] = {};
+	uint32_t n_received[MAX_NODES] = {}; // network thread only
+	uint32_t n_passed = 0; // critical section only
+
     BarrierHandler(Communicator* comm);
 
     void handle(msg::Barrier* msg);
     void wait_workers();
     void wait_nodes();
+    // also agrees on a value: returns the max of what every node passed.
+    uint32_t wait_nodes(uint32_t value);
     void my_wait(barrier_handler_arg_t* arg);
 };
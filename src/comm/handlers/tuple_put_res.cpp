@@ -24,6 +24,9 @@ void TuplePutResHandler::Counter::incr() {
 void TuplePutResHandler::Counter::decr() {
     cnt.fetch_sub(1);
 }
+bool TuplePutResHandler::Counter::is_zero() const {
+    return cnt.load(std::memory_order_relaxed) == 0;
+}
 void TuplePutResHandler::Counter::wait_zero() {
     while (cnt.load(std::memory_order_relaxed) != 0) {
         __builtin_ia32_pause();
@@ -12,6 +12,7 @@ struct TuplePutResHandler {
         void incr();
         void decr();
         void wait_zero();
+        bool is_zero() const;
     };
     std::vector<Counter> counts;
 
@@ -1,12 +1,51 @@
 #pragma once
 
+#include "ee/defs.hpp"
 #include "ee/types.hpp"
 #include "utils/ts_factory.hpp"
 #include "utils/util.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <cstdint>
 
-static constexpr size_t MSG_SIZE = 72;
+namespace msg {
+
+/*	Releases of the sender's earlier txns, riding along on its next get to the same node (or on a
+	TupleReleaseReq if there is none). They occupy the end of the frame, the receiver applies
+	them before the request itself, so the reply may overwrite them. */
+static constexpr size_t RELEASE_TUPLE_BYTES = 16;
+
+struct TupleRelease {
+    db_key_t rid;
+    p4db::table_t tid;
+    AccessMode mode;
+    uint32_t last_acq_pack;
+    uint8_t tuple[RELEASE_TUPLE_BYTES]; // only for WRITE
+};
+
+struct ReleaseTrailer {
+    uint8_t n = 0;
+    TupleRelease releases[PIGGYBACK_MAX_RELEASES];
+};
+
+/*	sizes of the requests a ReleaseTrailer rides on, needed before they are declared. Each is
+	checked against its sizeof below: a 16 byte Header, the fields of TupleMultiMsgHeader take 24
+	bytes, a TupleMultiEntry 24 and a fragment value 4, padded to 8. */
+static constexpr size_t TUPLE_GET_REQ_BYTES = 56;
+static constexpr size_t TUPLE_MULTI_GET_REQ_BYTES = 40 + 24*MULTI_GET_MAX_KEYS;
+static constexpr size_t TUPLE_FRAGMENT_REQ_BYTES = TUPLE_MULTI_GET_REQ_BYTES + (4*MULTI_GET_MAX_KEYS + 7) / 8 * 8;
+
+} // namespace msg
+
+/*	every message is sent as a fixed MSG_SIZE frame, multi-gets need room for MULTI_GET_MAX_KEYS
+	tuples, fragments for as many keys and values. Piggybacked releases only need a ReleaseTrailer
+	behind the largest request that is in use, the replies never carry one. */
+static constexpr size_t MSG_SIZE_NO_RELEASES = (USE_MULTI_GET || USE_FUNCTION_SHIPPING) ? 256 : 72;
+static constexpr size_t MSG_SIZE = !USE_PIGGYBACK_RELEASES ? MSG_SIZE_NO_RELEASES :
+    std::max({MSG_SIZE_NO_RELEASES, msg::TUPLE_GET_REQ_BYTES + sizeof(msg::ReleaseTrailer),
+        (USE_MULTI_GET ? msg::TUPLE_MULTI_GET_REQ_BYTES : 0) + sizeof(msg::ReleaseTrailer),
+        (USE_FUNCTION_SHIPPING ? msg::TUPLE_FRAGMENT_REQ_BYTES : 0) + sizeof(msg::ReleaseTrailer)});
 
 namespace msg {
 
@@ -40,6 +79,14 @@ enum class Type : uint32_t {
     TUPLE_GET_RES = 0x00000002,
     TUPLE_PUT_REQ = 0x00000003,
     TUPLE_PUT_RES = 0x00000004,
+    TUPLE_VALIDATE_REQ = 0x00000005,
+    TUPLE_VALIDATE_RES = 0x00000006,
+    TUPLE_MULTI_GET_REQ = 0x00000007,
+    TUPLE_MULTI_GET_RES = 0x00000008,
+    TUPLE_RELEASE_REQ = 0x00000009,
+    TUPLE_FRAGMENT_REQ = 0x0000000a,
+    TUPLE_FRAGMENT_RES = 0x0000000b,
+    TUPLE_FRAGMENT_END_REQ = 0x0000000c,
 };
 
 struct Header {
@@ -77,27 +124,40 @@ static_assert(sizeof(Init) <= MSG_SIZE);
 
 struct Barrier : public Base<Barrier, Type::BARRIER> {
     uint32_t num;
+    uint32_t value; // see BarrierHandler::wait_nodes(uint32_t)
 };
 static_assert(sizeof(Barrier) <= MSG_SIZE);
 
-// used by all 4 tuple interaction messages
+// bits of TupleMsgHeader::flags and TupleMultiMsgHeader::flags
+enum TupleFlags : uint8_t {
+    OPTIMISTIC = 0x01, // TupleGetReq: return tuple and version without locking
+    RELEASES = 0x02, // a ReleaseTrailer is attached
+    SNAPSHOT = 0x04, // TupleGetReq: return the tuple as of the start of epoch, without locking
+    ABORTED = 0x08, // TupleFragmentEndReq: put back the values the fragment overwrote
+};
+
+// used by all tuple interaction messages
 struct TupleMsgHeader {
     timestamp_t ts;
     p4db::table_t tid;
     db_key_t rid;
     AccessMode mode;
+    uint8_t flags = 0;
 };
 
 struct TupleGetReq : public Base<TupleGetReq, Type::TUPLE_GET_REQ>, public TupleMsgHeader {
 	uint32_t me_pack;
+	uint32_t epoch = 0; // SNAPSHOT only
 
     TupleGetReq(timestamp_t ts, p4db::table_t tid, db_key_t rid, AccessMode mode, TxnId me)
         : TupleMsgHeader{ts, tid, rid, mode}, me_pack(me.get_packed()) {}
 };
 static_assert(sizeof(TupleGetReq) <= MSG_SIZE);
+static_assert(sizeof(TupleGetReq) == TUPLE_GET_REQ_BYTES);
 
 struct TupleGetRes : public Base<TupleGetRes, Type::TUPLE_GET_RES>, public TupleMsgHeader {
 	uint32_t last_acq_pack;
+	uint32_t version;
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic"
     uint8_t tuple[0] __attribute__((aligned (sizeof(void*))));
@@ -136,4 +196,115 @@ struct TuplePutRes : public Base<TuplePutRes, Type::TUPLE_PUT_RES>, public Tuple
 };
 static_assert(sizeof(TuplePutRes) <= MSG_SIZE);
 
+// optimistic read set validation, the reply keeps mode==READ if the version still matches.
+struct TupleValidateReq : public Base<TupleValidateReq, Type::TUPLE_VALIDATE_REQ>, public TupleMsgHeader {
+	uint32_t version;
+
+    TupleValidateReq(timestamp_t ts, p4db::table_t tid, db_key_t rid, uint32_t version)
+        : TupleMsgHeader{ts, tid, rid, AccessMode::READ}, version(version) {}
+};
+static_assert(sizeof(TupleValidateReq) <= MSG_SIZE);
+
+struct TupleValidateRes : public Base<TupleValidateRes, Type::TUPLE_VALIDATE_RES>, public TupleMsgHeader {
+	uint32_t version;
+
+    TupleValidateRes(timestamp_t ts, p4db::table_t tid, db_key_t rid, uint32_t version)
+        : TupleMsgHeader{ts, tid, rid, AccessMode::READ}, version(version) {} // mode==INVALID if validation failed
+};
+static_assert(sizeof(TupleValidateRes) <= MSG_SIZE);
+
+struct TupleMultiEntry {
+    db_key_t rid;
+    AccessMode mode;
+    uint32_t last_acq_pack; // filled in by the reply
+    uint32_t version; // filled in by the reply
+};
+
+/*	all of a txn's keys on one node. They are granted all-or-nothing: if entry i can not be
+	locked, the entries before it are released again and the reply carries failed=i. */
+struct TupleMultiMsgHeader {
+    static constexpr uint8_t NONE = 0xff;
+
+    timestamp_t ts;
+    p4db::table_t tid;
+    uint32_t me_pack;
+    uint8_t n;
+    uint8_t failed;
+    uint8_t flags;
+    TupleMultiEntry entries[MULTI_GET_MAX_KEYS];
+};
+
+struct TupleMultiGetReq : public Base<TupleMultiGetReq, Type::TUPLE_MULTI_GET_REQ>, public TupleMultiMsgHeader {
+    TupleMultiGetReq(timestamp_t ts, p4db::table_t tid, TxnId me)
+        : TupleMultiMsgHeader{ts, tid, me.get_packed(), 0, NONE, 0, {}} {}
+
+    void add(db_key_t rid, AccessMode mode) {
+        assert(n < MULTI_GET_MAX_KEYS);
+        entries[n++] = TupleMultiEntry{rid, mode, 0, 0};
+    }
+};
+static_assert(!USE_MULTI_GET || sizeof(TupleMultiGetReq) <= MSG_SIZE);
+static_assert(sizeof(TupleMultiGetReq) == TUPLE_MULTI_GET_REQ_BYTES);
+
+struct TupleMultiGetRes : public Base<TupleMultiGetRes, Type::TUPLE_MULTI_GET_RES>, public TupleMultiMsgHeader {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    uint8_t tuples[0] __attribute__((aligned (sizeof(void*))));
+#pragma GCC diagnostic pop
+
+    uint8_t* tuple(size_t i, size_t tuple_size) {
+        return &tuples[i * tuple_size];
+    }
+
+    static constexpr auto size(size_t n, size_t tuple_size) {
+        return sizeof(TupleMultiGetRes) + n * tuple_size;
+    }
+};
+static_assert(!USE_MULTI_GET || sizeof(TupleMultiGetRes) <= MSG_SIZE);
+
+/*	Function shipping: a txn's keys on one node, run there by the msg-handler. It latches them
+	all-or-nothing like a multi-get, installs the values of the WRITE entries right away and
+	votes with failed. In the reply values[] holds what was read, for a WRITE the value it
+	replaced, so no tuple crosses the wire. The reply comes back as a TupleFragmentEndReq with
+	the txn's outcome, which releases the keys. */
+struct TupleFragmentMsgHeader : public TupleMultiMsgHeader {
+    uint32_t values[MULTI_GET_MAX_KEYS];
+};
+
+struct TupleFragmentReq : public Base<TupleFragmentReq, Type::TUPLE_FRAGMENT_REQ>, public TupleFragmentMsgHeader {
+    TupleFragmentReq(timestamp_t ts, p4db::table_t tid, TxnId me)
+        : TupleFragmentMsgHeader{{ts, tid, me.get_packed(), 0, NONE, 0, {}}, {}} {}
+
+    void add(db_key_t rid, AccessMode mode, uint32_t value) {
+        assert(n < MULTI_GET_MAX_KEYS);
+        values[n] = value;
+        entries[n++] = TupleMultiEntry{rid, mode, 0, 0};
+    }
+};
+static_assert(!USE_FUNCTION_SHIPPING || sizeof(TupleFragmentReq) <= MSG_SIZE);
+static_assert(sizeof(TupleFragmentReq) == TUPLE_FRAGMENT_REQ_BYTES);
+
+struct TupleFragmentRes : public Base<TupleFragmentRes, Type::TUPLE_FRAGMENT_RES>, public TupleFragmentMsgHeader {};
+static_assert(!USE_FUNCTION_SHIPPING || sizeof(TupleFragmentRes) <= MSG_SIZE);
+
+// entries[].last_acq_pack is set by the sender, answered with a TuplePutRes.
+struct TupleFragmentEndReq : public Base<TupleFragmentEndReq, Type::TUPLE_FRAGMENT_END_REQ>, public TupleFragmentMsgHeader {};
+static_assert(!USE_FUNCTION_SHIPPING || sizeof(TupleFragmentEndReq) <= MSG_SIZE);
+
+
+inline ReleaseTrailer* release_trailer(Header* msg) {
+    return reinterpret_cast<ReleaseTrailer*>(reinterpret_cast<uint8_t*>(msg) + MSG_SIZE - sizeof(ReleaseTrailer));
+}
+
+// carries only a ReleaseTrailer, answered with a TuplePutRes.
+struct TupleReleaseReq : public Base<TupleReleaseReq, Type::TUPLE_RELEASE_REQ>, public TupleMsgHeader {
+    TupleReleaseReq()
+        : TupleMsgHeader{0, p4db::table_t{0}, 0, AccessMode::READ, TupleFlags::RELEASES} {}
+};
+
+static_assert(!USE_PIGGYBACK_RELEASES || sizeof(TupleGetReq) + sizeof(ReleaseTrailer) <= MSG_SIZE);
+static_assert(!USE_PIGGYBACK_RELEASES || !USE_MULTI_GET || sizeof(TupleMultiGetReq) + sizeof(ReleaseTrailer) <= MSG_SIZE);
+static_assert(!USE_PIGGYBACK_RELEASES || sizeof(TupleReleaseReq) + sizeof(ReleaseTrailer) <= MSG_SIZE);
+static_assert(!USE_PIGGYBACK_RELEASES || !USE_FUNCTION_SHIPPING || sizeof(TupleFragmentReq) + sizeof(ReleaseTrailer) <= MSG_SIZE);
+
 } // namespace msg
@@ -29,6 +29,11 @@ void MessageHandler::handle(Pkt_t* pkt) {
         pkt->dump(std::cout);
     }
 
+    // every incoming message gives the parked lock requests whose time is up their refusal.
+    if constexpr (USE_REMOTE_LOCK_QUEUE) {
+        StructTable::Row_t::parked().expire(*comm);
+    }
+
     switch (msg->type) {
         case Type::INIT:
             return handle(pkt, msg->as<msg::Init>());
@@ -42,6 +47,22 @@ void MessageHandler::handle(Pkt_t* pkt) {
             return handle(pkt, msg->as<msg::TuplePutReq>());
         case Type::TUPLE_PUT_RES:
             return handle(pkt, msg->as<msg::TuplePutRes>());
+        case Type::TUPLE_VALIDATE_REQ:
+            return handle(pkt, msg->as<msg::TupleValidateReq>());
+        case Type::TUPLE_VALIDATE_RES:
+            return handle(pkt, msg->as<msg::TupleValidateRes>());
+        case Type::TUPLE_MULTI_GET_REQ:
+            return handle(pkt, msg->as<msg::TupleMultiGetReq>());
+        case Type::TUPLE_MULTI_GET_RES:
+            return handle(pkt, msg->as<msg::TupleMultiGetRes>());
+        case Type::TUPLE_RELEASE_REQ:
+            return handle(pkt, msg->as<msg::TupleReleaseReq>());
+        case Type::TUPLE_FRAGMENT_REQ:
+            return handle(pkt, msg->as<msg::TupleFragmentReq>());
+        case Type::TUPLE_FRAGMENT_RES:
+            return handle(pkt, msg->as<msg::TupleFragmentRes>());
+        case Type::TUPLE_FRAGMENT_END_REQ:
+            return handle(pkt, msg->as<msg::TupleFragmentEndReq>());
     }
 }
 
@@ -61,6 +82,7 @@ void MessageHandler::handle(Pkt_t* pkt, msg::Barrier* msg) {
 
 void MessageHandler::handle(Pkt_t* pkt, msg::TupleGetReq* req) {
     // std::cerr << "msg::TupleGetReq tid=" << req->tid << " rid=" << req->rid << " mode=" << static_cast<int>(req->mode) << '\n';
+    apply_releases(req, req->flags);
 
     auto table = db[req->tid];
     table->remote_get(pkt, req);
@@ -101,3 +123,88 @@ void MessageHandler::handle(Pkt_t* pkt, msg::TuplePutRes* res) {
     putresponses.handle(res->sender);
     pkt->free();
 }
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleValidateReq* req) {
+    auto table = db[req->tid];
+    table->remote_validate(pkt, req);
+}
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleValidateRes* res) {
+    future_map_t::accessor acc;
+    bool found = open_futures.find(acc, res->msg_id);
+    assert(found == true);
+
+    AbstractFuture* future = acc->second;
+    bool success = open_futures.erase(acc);
+    assert(success == true);
+
+    future->set_pkt(pkt);
+}
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleMultiGetReq* req) {
+    apply_releases(req, req->flags);
+    auto table = db[req->tid];
+    table->remote_get(pkt, req);
+}
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleMultiGetRes* res) {
+    future_map_t::accessor acc;
+    bool found = open_futures.find(acc, res->msg_id);
+    assert(found == true);
+
+    AbstractFuture* future = acc->second;
+    bool success = open_futures.erase(acc);
+    assert(success == true);
+
+    future->set_pkt(pkt);
+}
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleReleaseReq* req) {
+    apply_releases(req, req->flags);
+
+    auto res = req->convert<msg::TuplePutRes>();
+    pkt->resize(res->size());
+    comm->send(res->sender, pkt, tid);
+}
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleFragmentReq* req) {
+    apply_releases(req, req->flags);
+    auto table = db[req->tid];
+    table->remote_execute(pkt, req);
+}
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleFragmentRes* res) {
+    future_map_t::accessor acc;
+    bool found = open_futures.find(acc, res->msg_id);
+    assert(found == true);
+
+    AbstractFuture* future = acc->second;
+    bool success = open_futures.erase(acc);
+    assert(success == true);
+
+    future->set_pkt(pkt);
+}
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleFragmentEndReq* req) {
+    auto table = db[req->tid];
+    table->remote_end(req);
+
+    auto ts = req->ts;
+    auto sender = req->sender;
+    auto res = pkt->ctor<msg::TuplePutRes>(ts, table->id, db_key_t{0}, AccessMode::WRITE);
+    res->sender = sender;
+    comm->send(sender, pkt, tid);
+}
+
+// releases piggybacked on msg go first, the sender may be about to lock the same keys again.
+void MessageHandler::apply_releases(msg::Header* msg, uint8_t& flags) {
+    if (!(flags & msg::TupleFlags::RELEASES)) {
+        return;
+    }
+    auto trailer = msg::release_trailer(msg);
+    for (uint8_t i = 0; i < trailer->n; ++i) {
+        auto& rel = trailer->releases[i];
+        db[rel.tid]->remote_put(rel);
+    }
+    flags &= ~msg::TupleFlags::RELEASES;
+}
@@ -62,4 +62,14 @@ private:
     void handle(Pkt_t* pkt, msg::TupleGetRes* res);
     void handle(Pkt_t* pkt, msg::TuplePutReq* req);
     void handle(Pkt_t* pkt, msg::TuplePutRes* res);
+    void handle(Pkt_t* pkt, msg::TupleValidateReq* req);
+    void handle(Pkt_t* pkt, msg::TupleValidateRes* res);
+    void handle(Pkt_t* pkt, msg::TupleMultiGetReq* req);
+    void handle(Pkt_t* pkt, msg::TupleMultiGetRes* res);
+    void handle(Pkt_t* pkt, msg::TupleReleaseReq* req);
+    void handle(Pkt_t* pkt, msg::TupleFragmentReq* req);
+    void handle(Pkt_t* pkt, msg::TupleFragmentRes* res);
+    void handle(Pkt_t* pkt, msg::TupleFragmentEndReq* req);
+
+    void apply_releases(msg::Header* msg, uint8_t& flags);
 };
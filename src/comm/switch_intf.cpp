@@ -88,6 +88,18 @@ void switch_intf_t::setup() {
     int rc = bind(sockfd, (struct sockaddr*) &addr.mac_addr, sizeof(sockaddr_ll));
     assert(rc == 0);
 
+    // the extra senders bind without a protocol, so they get no copy of what sockfd receives.
+    tx_sockfds.push_back(sockfd);
+    for (size_t k = 1; k<HOT_TX_THREADS; ++k) {
+        int tx_sockfd = socket(AF_PACKET, SOCK_RAW, 0);
+        assert(tx_sockfd >= 0);
+        struct sockaddr_ll tx_addr = addr.mac_addr;
+        tx_addr.sll_protocol = 0;
+        rc = bind(tx_sockfd, (struct sockaddr*) &tx_addr, sizeof(sockaddr_ll));
+        assert(rc == 0);
+        tx_sockfds.push_back(tx_sockfd);
+    }
+
     if (!ORIG_MODE) {
         struct tpacket_req treq = {0};
         treq.tp_frame_size = TPACKET_ALIGN(TPACKET_HDRLEN + 14) + TPACKET_ALIGN(944);
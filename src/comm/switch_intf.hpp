@@ -16,6 +16,8 @@
 #include <sys/types.h>
 #include <sys/uio.h>
 
+#include <vector>
+
 static constexpr uint16_t P4DB_ETHER_TYPE = 0x88b5;
 static constexpr size_t MAC_ADDR_BYTES = 6;
 static constexpr size_t N_SECS_TIMEOUT = 5;
@@ -23,6 +25,7 @@ static constexpr size_t N_NSECS_TIMEOUT = 0;
 
 struct switch_intf_t {
     int sockfd;
+    std::vector<int> tx_sockfds; // HOT_TX_THREADS send-only sockets, the first one is sockfd
     std::thread sw_recv_thr;
 
     union {
@@ -4,6 +4,7 @@
 #include "ee/types.hpp"
 #include "ee/loc_info.hpp"
 #include "layout/declustered_layout.hpp"
+#include "utils/ts_factory.hpp"
 
 #include <array>
 #include <bitset>
@@ -23,6 +24,8 @@ struct Txn {
 	std::array<std::pair<OP, TupleLocation>, MAX_OPS_PASS2_ACCEL> hot_ops_pass2;
 	bool init_done;
 	bool do_accel;
+	bool all_local; // every cold op is on this node, see TxnExecutor::run_local
+	bool read_only; // every cold op is a READ, see TxnExecutor::read_only_execute
 	size_t n_aborts;
 	std::optional<size_t> hottest_cold_i1;
 	std::optional<size_t> hottest_cold_i2;
@@ -30,6 +33,20 @@ struct Txn {
 	std::bitset<N_SW_LOCKS> locks_acquire;
 	TxnId id;
     size_t loader_id;
+	// assigned on the first attempt and kept across retries, for the cc policy.
+	timestamp_t ts;
+	// per cold op, set by the LockAheadTable planner when USE_LOCK_AHEAD.
+	std::array<uint32_t, N_OPS> lock_ahead_slot;
 
-	Txn() : init_done(false), do_accel(false), n_aborts(0) {}
+	Txn() : init_done(false), do_accel(false), all_local(false), read_only(false), n_aborts(0), ts(0) {}
+
+	void classify_cold_ops() {
+		all_local = true;
+		read_only = true;
+		for (size_t i = 0; i<N_OPS && cold_ops[i].mode != AccessMode::INVALID; ++i) {
+			// a write to a replicated key also locks the copies on the other nodes.
+			all_local &= cold_ops[i].loc_info.is_local && !(cold_ops[i].loc_info.replicated && cold_ops[i].mode == AccessMode::WRITE);
+			read_only &= cold_ops[i].mode == AccessMode::READ;
+		}
+	}
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ee/defs.hpp"
+#include "main/config.hpp"
+#include "utils/ts_factory.hpp"
+
+#include <atomic>
+#include <limits>
+#include <type_traits>
+
+/*	Conflict resolution for Row locks, selected at build time by CC_POLICY.
+	NO_WAIT:    abort on any incompatible lock (the original behavior).
+	WAIT_DIE:   an older requester spins on the row, a younger one aborts.
+	WOUND_WAIT: an older requester wounds the local holder and spins, a younger one spins.
+	Waiting is always bounded by MAX_LOCK_WAIT_SPINS, so a missed wound or a cycle through a
+	remote node degrades into an abort instead of a deadlock. Timestamps are kept across
+	retries of the same txn (Txn::ts), so an aborted txn eventually becomes the oldest. */
+namespace cc {
+
+static constexpr size_t MAX_WORKERS = 32;
+static constexpr timestamp_t NO_TS = std::numeric_limits<timestamp_t>::max();
+
+static_assert(CC_POLICY != CCPolicy::WOUND_WAIT ||
+	std::is_same_v<TimestampFactory, UniqueClockTimestampFactory>,
+	"WOUND_WAIT needs to find the holder's worker from its timestamp");
+
+// holds the ts of the txn that was wounded on each worker, compared against the current ts.
+inline std::atomic<timestamp_t> wounded_ts[MAX_WORKERS];
+
+inline void wound(timestamp_t holder_ts) {
+	if (holder_ts == NO_TS) {
+		return;
+	}
+	// can only wound txns of this node, remote holders just get waited on.
+	if (UniqueClockTimestampFactory::node_of(holder_ts) != Config::instance().node_id) {
+		return;
+	}
+	wounded_ts[UniqueClockTimestampFactory::tid_of(holder_ts)].store(holder_ts, std::memory_order_relaxed);
+}
+
+inline bool is_wounded(uint32_t tid, timestamp_t ts) {
+	if constexpr (CC_POLICY != CCPolicy::WOUND_WAIT) {
+		return false;
+	}
+	return wounded_ts[tid].load(std::memory_order_relaxed) == ts;
+}
+
+/*	Called after a lock request found an incompatible holder. Returns whether to spin and
+	try again. can_block is false on the msg-handler thread, which must never spin. */
+inline bool should_wait(timestamp_t ts, timestamp_t holder_ts, size_t spins, bool can_block) {
+	if constexpr (CC_POLICY == CCPolicy::NO_WAIT) {
+		return false;
+	} else if constexpr (CC_POLICY == CCPolicy::WAIT_DIE) {
+		return can_block && spins < MAX_LOCK_WAIT_SPINS && ts < holder_ts;
+	} else {
+		if (ts < holder_ts && spins == 0) {
+			wound(holder_ts);
+		}
+		return can_block && spins < MAX_LOCK_WAIT_SPINS;
+	}
+}
+
+} // namespace cc
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "ee/future.hpp"
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <utility>
+#include <vector>
+
+/*	Coroutine support for the txn executor. A txn is a chain of lazily started tasks; when the
+	innermost one has to wait for a reply it stores what it waits on in the thread's current
+	waiter_t and the whole chain suspends. Whoever drives the chain (run_sync, or
+	TxnExecutor::run_inflight for many txns at once) polls the waiter and resumes it. */
+namespace coro {
+
+struct waiter_t {
+	std::coroutine_handle<> handle;
+	bool (*poll)(const void*) = nullptr;
+	const void* arg = nullptr;
+
+	bool ready() const {
+		return poll(arg);
+	}
+};
+
+// set by the driver before it resumes a chain.
+inline thread_local waiter_t* cur_waiter = nullptr;
+
+struct until {
+	bool (*poll)(const void*);
+	const void* arg;
+
+	bool await_ready() const {
+		return poll(arg);
+	}
+	void await_suspend(std::coroutine_handle<> h) const {
+		*cur_waiter = waiter_t{h, poll, arg};
+	}
+	void await_resume() const {}
+};
+
+// suspends until the msg-handler delivered the reply of future.
+inline until until_ready(AbstractFuture* future) {
+	return until{[](const void* f) { return static_cast<const AbstractFuture*>(f)->ready(); }, future};
+}
+
+// gives the other in-flight txns of the worker a turn.
+inline auto yield() {
+	struct yield_awaiter : until {
+		bool await_ready() const {
+			return false;
+		}
+	};
+	return yield_awaiter{{[](const void*) { return true; }, nullptr}};
+}
+
+/*	Frames are recycled per worker thread, otherwise every txn (and every lock it takes) would
+	go through malloc. Frames larger than FRAME_BYTES are rare and not cached. */
+struct frame_cache_t {
+	static constexpr size_t FRAME_BYTES = 2048;
+	std::vector<void*> free;
+
+	~frame_cache_t() {
+		for (void* frame : free) {
+			::operator delete(frame);
+		}
+	}
+};
+inline thread_local frame_cache_t frame_cache;
+
+struct frame_alloc {
+	static void* operator new(size_t size) {
+		if (size > frame_cache_t::FRAME_BYTES) {
+			return ::operator new(size);
+		}
+		if (frame_cache.free.empty()) {
+			return ::operator new(frame_cache_t::FRAME_BYTES);
+		}
+		void* frame = frame_cache.free.back();
+		frame_cache.free.pop_back();
+		return frame;
+	}
+
+	static void operator delete(void* frame, size_t size) {
+		if (size > frame_cache_t::FRAME_BYTES) {
+			::operator delete(frame);
+			return;
+		}
+		frame_cache.free.push_back(frame);
+	}
+};
+
+template <typename T>
+struct task {
+	struct promise_type : frame_alloc {
+		T value{};
+		std::exception_ptr exception;
+		std::coroutine_handle<> continuation = std::noop_coroutine();
+
+		task get_return_object() {
+			return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+		}
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+		auto final_suspend() noexcept {
+			// hand control back to whoever awaited this task.
+			struct final_awaiter {
+				bool await_ready() noexcept {
+					return false;
+				}
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+					return h.promise().continuation;
+				}
+				void await_resume() noexcept {}
+			};
+			return final_awaiter{};
+		}
+		void return_value(T v) {
+			value = std::move(v);
+		}
+		void unhandled_exception() {
+			exception = std::current_exception();
+		}
+	};
+
+	std::coroutine_handle<promise_type> handle;
+
+	explicit task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+	task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	task(const task&) = delete;
+	task& operator=(task&& other) noexcept {
+		std::swap(handle, other.handle);
+		return *this;
+	}
+	~task() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+
+	bool done() const {
+		return handle.done();
+	}
+
+	T result() {
+		if (handle.promise().exception) {
+			std::rethrow_exception(handle.promise().exception);
+		}
+		return std::move(handle.promise().value);
+	}
+
+	// awaiting a task starts it, and it resumes the awaiter when it returns.
+	bool await_ready() const {
+		return false;
+	}
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+		handle.promise().continuation = awaiting;
+		return handle;
+	}
+	T await_resume() {
+		return result();
+	}
+};
+
+// drives t to completion on this thread, spinning whenever it waits.
+template <typename T>
+T run_sync(task<T> t) {
+	waiter_t waiter;
+	waiter_t* outer = std::exchange(cur_waiter, &waiter);
+
+	std::coroutine_handle<> next = t.handle;
+	while (true) {
+		next.resume();
+		if (t.done()) {
+			break;
+		}
+		while (!waiter.ready()) {
+			__builtin_ia32_pause();
+		}
+		next = waiter.handle;
+	}
+
+	cur_waiter = outer;
+	return t.result();
+}
+
+} // namespace coro
@@ -3,6 +3,10 @@
 #include "comm/comm.hpp"
 #include "comm/msg.hpp"
 #include "comm/msg_handler.hpp"
+#include "ee/lock_ahead.hpp"
+#include "ee/mb_tuner.hpp"
+#include "ee/retry_sched.hpp"
+#include "ee/steal.hpp"
 #include "ee/table.hpp"
 #include "utils/rbarrier.hpp"
 
@@ -64,6 +68,8 @@ struct hot_send_q_t {
 
 extern void single_db_section(void* arg);
 
+struct scheduler_t;
+
 class Database {
     std::vector<Table*> table_ids;
     std::unordered_map<std::string, Table*> table_names;
@@ -75,20 +81,29 @@ public:
 	size_t n_threads;
 	uint32_t thr_batch_done_ct;
 	std::vector<Txn>** per_core_txns;
+	scheduler_t** per_core_sched;
+	std::atomic<uint32_t> prep_next{0}; // next worker whose batch is up for preparing
 	hot_send_q_t hot_send_q;
     int sched_sockfd;
     reusable_barrier_t batch_bar;
+    LockAheadTable lock_ahead;
+    RetryTokens retry_tokens;
+    WorkStealing work_stealing;
+    MiniBatchTuner mb_tuner;
+    BatchDeadline batch_deadline;
+    std::atomic<uint32_t> hot_period_batch; // 1+ the batch whose hot period the leader runs, see USE_HOT_OVERLAP
 
     void setup_sched_sock();
-    void update_alloc(uint32_t batch_num);
+    void update_alloc(uint32_t batch_num, uint64_t start_delay_ns = COLD_BATCH_DUR_EST_NS, uint64_t duration_ns = HOT_BATCH_DUR_EST_NS);
     void wait_sched_ready();
 
 public:
-    Database(size_t n_threads) : n_threads(n_threads), thr_batch_done_ct(0), hot_send_q(BATCH_SIZE_TGT), batch_bar(n_threads, single_db_section, false) {
+    Database(size_t n_threads) : n_threads(n_threads), thr_batch_done_ct(0), hot_send_q(BATCH_SIZE_TGT), batch_bar(n_threads, single_db_section, false), lock_ahead(n_threads), work_stealing(n_threads), mb_tuner(n_threads), batch_deadline(n_threads), hot_period_batch(0) {
         comm = std::make_unique<Communicator>();
         msg_handler = std::make_unique<MessageHandler>(*this, comm.get());
         msg_handler->init.wait();
 		per_core_txns = (std::vector<Txn>**) malloc(sizeof(per_core_txns[0])*n_threads);
+		per_core_sched = (scheduler_t**) malloc(sizeof(per_core_sched[0])*n_threads);
         setup_sched_sock();
     }
 
@@ -29,12 +29,85 @@ constexpr size_t REMOTE_FRAC = 10;
 constexpr size_t BATCH_SIZE_TGT = 100000;
 constexpr size_t MINI_BATCH_SIZE_TGT = 5000;
 constexpr size_t MIN_MINI_BATCH_THR_SIZE = 50;
+// resize the mini-batches of each batch from the last one's aborts and barrier waits, see MiniBatchTuner
+constexpr bool USE_ADAPTIVE_MINI_BATCH = false;
+constexpr size_t MIN_MINI_BATCHES = 5; // per batch
+constexpr size_t MAX_MINI_BATCHES = 80;
+constexpr size_t ADAPT_ABORT_PCT = 5;
+constexpr size_t ADAPT_WAIT_PCT = 10;
+// size batches to finish within BATCH_DEADLINE_NS and close mini-batches after MINI_BATCH_DEADLINE_NS, see BatchDeadline
+constexpr bool USE_BATCH_DEADLINE = false;
+constexpr uint64_t BATCH_DEADLINE_NS = 5000000ULL;
+constexpr uint64_t MINI_BATCH_DEADLINE_NS = 250000ULL;
 constexpr size_t MAX_PASSES_ACCEL = 1;
 constexpr size_t MAX_OPS_PASS2_ACCEL = 8;
 constexpr size_t MAX_HOT_OPS = 8;
 constexpr size_t N_REGS = 72; // do even for orig mode...
 constexpr size_t N_SW_LOCKS = 32;
 
+// concurrency control on the cold path, see ee/cc_policy.hpp
+enum class CCPolicy {
+	NO_WAIT,
+	WAIT_DIE,
+	WOUND_WAIT,
+};
+constexpr CCPolicy CC_POLICY = CCPolicy::NO_WAIT;
+constexpr size_t MAX_LOCK_WAIT_SPINS = 4096;
+// run cold txns (TxnExecutor::execute) optimistically, validating reads at commit.
+constexpr bool USE_OCC_COLD = false;
+// plan local lock order for each batch up front and wait on it instead of aborting, see ee/lock_ahead.hpp
+constexpr bool USE_LOCK_AHEAD = false;
+// idle workers steal txns of the current mini-batch from busy ones, see ee/steal.hpp
+constexpr bool USE_WORK_STEALING = false;
+// lock all of a txn's keys on a remote node with one TupleMultiGetReq (needs the larger MSG_SIZE).
+constexpr bool USE_MULTI_GET = false;
+constexpr size_t MULTI_GET_MAX_KEYS = 4;
+// hold remote releases back until the next get to the same node and send them along, see msg::ReleaseTrailer
+// (every frame grows by the trailer, 72 -> 224 bytes, so it pays off only when releases are a large share of the messages)
+constexpr bool USE_PIGGYBACK_RELEASES = false;
+constexpr size_t PIGGYBACK_MAX_RELEASES = 4;
+// park a TupleGetReq on a busy row until it is released instead of refusing it, see ParkedLocks
+constexpr bool USE_REMOTE_LOCK_QUEUE = false;
+constexpr size_t REMOTE_LOCK_QUEUE_LEN = 4;
+constexpr uint64_t REMOTE_LOCK_WAIT_NS = 100000;
+// run a txn's keys on another node there, one fragment per node, see StructTable::remote_execute
+constexpr bool USE_FUNCTION_SHIPPING = false;
+// copies of the READ_REPLICA_KEYS most frequent cold keys on every node, see DeclusteredLayout::choose_replicas
+constexpr bool USE_READ_REPLICAS = false;
+constexpr size_t READ_REPLICA_KEYS = 4096;
+constexpr int READ_REPLICA_MAX_WRITE_PCT = 20;
+constexpr size_t READ_REPLICA_MAX_NODES = 8;
+// run the leftovers that touch no hot key while the leader streams the hot period, see TxnExecutor::run_unfenced_leftovers
+constexpr bool USE_HOT_OVERLAP = false;
+// workers that wait out the hot period schedule the next batch for everyone, see prepare_next_batches
+constexpr bool USE_BATCH_PIPELINE = false;
+// commit/rollback do not wait for the TuplePutRes of their releases, see TxnExecutor::drain_releases
+constexpr bool USE_ASYNC_COMMIT = false;
+// leftover retries, see ee/retry_sched.hpp
+constexpr uint32_t RETRY_SERIALIZE_ABORTS = 4;
+constexpr size_t RETRY_TOKEN_STRIPES = 1024;
+constexpr uint64_t RETRY_BACKOFF_NS = 2000;
+constexpr uint32_t RETRY_BACKOFF_MAX_SHIFT = 8;
+// abort cost of a remote lock relative to a local one, for ordering cold ops (see extract_hot_cold)
+constexpr size_t REMOTE_LOCK_COST = 8;
+// run txns whose cold ops are all local without futures or undo log, see TxnExecutor::run_local
+constexpr bool USE_LOCAL_FAST_PATH = false;
+// run read-only cold txns (TxnExecutor::execute) with version-validated reads, no latches
+constexpr bool USE_OPTIMISTIC_READ_ONLY = false;
+// keep each row's value as of the batch start, read-only txns without hot ops read that, see Row::snapshot_read
+constexpr bool USE_SNAPSHOT_READS = false;
+// send all remote gets of a txn before waiting on any of them.
+constexpr bool USE_PIPELINED_GETS = false;
+// prefetch the rows of the txn PREFETCH_TXN_DISTANCE ahead in the queue, see TxnExecutor::prefetch_ahead
+constexpr bool USE_ROW_PREFETCH = false;
+constexpr size_t PREFETCH_TXN_DISTANCE = 4;
+// interleave CORO_INFLIGHT_TXNS txns per worker, see TxnExecutor::run_inflight
+constexpr bool USE_CORO_EXECUTOR = false;
+constexpr size_t CORO_INFLIGHT_TXNS = 8;
+
+// threads that send the hot period, each through its own switch socket, see hot_tx_pool_t
+constexpr size_t HOT_TX_THREADS = 1;
+
 // measure and modify (right now around 1 ms each)
 constexpr uint64_t COLD_BATCH_DUR_EST_NS = 1000000ULL; 
 constexpr uint64_t HOT_BATCH_DUR_EST_NS = 1000000ULL;
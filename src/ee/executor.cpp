@@ -18,51 +18,81 @@ static uint64_t micros_diff(struct timespec* t_start, struct timespec* t_end) {
     uint64_t e_micros = ((((uint64_t) t_end->tv_sec) * 1000000000) + t_end->tv_nsec) / 1000;
     return e_micros-s_micros;
 }
+
+extern uint64_t log_wait_time[32];
 	
-RC TxnExecutor::my_execute(Txn& arg, void** packet_fill) {
-	int rc = clock_gettime(CLOCK_MONOTONIC, &ts_txn_begin);
+/*	Hot ops run on the switch at a later point than the batch start, so a txn that has any can
+	not read a snapshot. */
+static bool snapshot_eligible(const Txn& arg) {
+	return arg.read_only && (!arg.do_accel || arg.hot_ops_pass1[0].first.mode == AccessMode::INVALID);
+}
+
+coro::task<RC> TxnExecutor::my_execute(Txn& arg, void** packet_fill) {
+	int rc = clock_gettime(CLOCK_MONOTONIC, &ctx->ts_txn_begin);
 	assert(rc == 0);
 
 	arg.id.field.valid = true;
 	assert(arg.id.field.mini_batch_id == mini_batch_num);
+	ctx->ts = txn_ts(arg);
+	ctx->abort_key = RetryScheduler::NO_KEY;
+	ctx->replica_writes.clear();
+	if (USE_SNAPSHOT_READS && snapshot_eligible(arg)) {
+		RC ret = co_await snapshot_execute(arg);
+		if (ret == RC::COMMIT) {
+			*packet_fill = db.hot_send_q.alloc_slot(mini_batch_num, &arg);
+		}
+		co_return ret;
+	}
+	if (USE_LOCAL_FAST_PATH && arg.all_local) {
+		co_return run_local<true>(arg, packet_fill);
+	}
 	// acquire all locks first, ex and shared. Can rollback within loop
 
-	TupleFuture<KV>* ops[N_OPS];
+	TupleFuture<KV>* ops[N_OPS] = {};
+	if (USE_PIPELINED_GETS && !co_await acquire_pipelined(arg, ops)) {
+		struct timespec ts_curr;
+		rc = clock_gettime(CLOCK_MONOTONIC, &ts_curr);
+		assert(rc == 0);
+		t_abort += micros_diff(&ctx->ts_txn_begin, &ts_curr);
+		co_return co_await rollback();
+	}
 	for (size_t i = 0; auto& op : arg.cold_ops) {
-		if (op.mode == AccessMode::WRITE) {
-			ops[i] = write(kvs, op, arg.id);
-		} else if (op.mode == AccessMode::READ) {
-			ops[i] = read(kvs, op, arg.id);
+		if constexpr (USE_LOCK_AHEAD) {
+			db.lock_ahead.wait(arg, i);
+		}
+		if (ops[i]) {
+			// already locked by acquire_pipelined or the multi-get of an earlier op
+		} else if ((USE_MULTI_GET || USE_FUNCTION_SHIPPING) && op.mode != AccessMode::INVALID && !op.loc_info.is_local) {
+			ops[i] = co_await multi_get(kvs, arg, i, ops);
+		} else if (op.mode == AccessMode::WRITE || op.mode == AccessMode::READ) {
+			ops[i] = co_await lock(kvs, op, arg.id);
 		} else {
 			assert(op.mode == AccessMode::INVALID);
 			break;
 		}
 
-        /*
-        int prio = -1;
-        if (arg.hottest_cold_i1.has_value()) {
-            if (op.id == arg.cold_ops[arg.hottest_cold_i1.value()].id) {
-                prio = 1;
-            }
-        }
-        if (arg.hottest_cold_i2.has_value()) {
-            if (op.id == arg.cold_ops[arg.hottest_cold_i2.value()].id) {
-                prio = 2;
-            }
-        }
-        */
-
-		if (!ops[i]) {
-            // fprintf(stderr, "R mb=%u thr=%u id=%lu k=%lu(%d)\n", mini_batch_num, WorkerContext::get().tid, arg.loader_id, op.id, prio);
+		if (!ops[i] || cc::is_wounded(tid, ctx->ts)) {
+            // fprintf(stderr, "R mb=%u thr=%u id=%lu k=%lu\n", mini_batch_num, WorkerContext::get().tid, arg.loader_id, op.id);
+			if (ctx->abort_key == RetryScheduler::NO_KEY) {
+				ctx->abort_key = op.id;
+			}
 
 			struct timespec ts_curr;
 			rc = clock_gettime(CLOCK_MONOTONIC, &ts_curr);
 			assert(rc == 0);
-			t_abort += micros_diff(&ts_txn_begin, &ts_curr);
-			return rollback();
+			t_abort += micros_diff(&ctx->ts_txn_begin, &ts_curr);
+			co_return co_await rollback();
 		} else {
-            // fprintf(stderr, "C mb=%u thr=%u id=%lu k=%lu(%d)\n", mini_batch_num, WorkerContext::get().tid, arg.loader_id, op.id, prio);
+            // fprintf(stderr, "C mb=%u thr=%u id=%lu k=%lu\n", mini_batch_num, WorkerContext::get().tid, arg.loader_id, op.id);
         }
+		if (USE_READ_REPLICAS && op.loc_info.replicated && op.mode == AccessMode::WRITE && !co_await lock_replicas(kvs, op, i, arg.id)) {
+			ctx->abort_key = op.id;
+			struct timespec ts_curr;
+			rc = clock_gettime(CLOCK_MONOTONIC, &ts_curr);
+			assert(rc == 0);
+			t_abort += micros_diff(&ctx->ts_txn_begin, &ts_curr);
+			co_return co_await rollback();
+		}
 		++i;
 	}
 
@@ -71,14 +101,17 @@ RC TxnExecutor::my_execute(Txn& arg, void** packet_fill) {
 		if (op.mode == AccessMode::WRITE) {
 			auto x = ops[i]->get();
 			if (!x) {
-				return rollback();
+				co_return co_await rollback();
 			}
 			x->value = op.value;
 			ops[i]->last_acq = arg.id;
+			if (USE_READ_REPLICAS && op.loc_info.replicated) {
+				write_replicas(i, op.value, arg.id);
+			}
 		} else if (op.mode == AccessMode::READ) {
 			const auto x = ops[i]->get();
 			if (!x) {
-				return rollback();
+				co_return co_await rollback();
 			}
 			const auto value = x->value;
 			do_not_optimize(value);
@@ -91,39 +124,70 @@ RC TxnExecutor::my_execute(Txn& arg, void** packet_fill) {
 
 	*packet_fill = db.hot_send_q.alloc_slot(mini_batch_num, &arg);
 	// locks automatically released
-	RC ret = commit();
+	RC ret = co_await commit();
 
 	struct timespec ts_curr;
 	rc = clock_gettime(CLOCK_MONOTONIC, &ts_curr);
 	assert(rc == 0);
-	t_commit += micros_diff(&ts_txn_begin, &ts_curr);
+	t_commit += micros_diff(&ctx->ts_txn_begin, &ts_curr);
 
-	return ret;
+	co_return ret;
 }
 
-RC TxnExecutor::execute(Txn& arg) {
+coro::task<RC> TxnExecutor::execute(Txn& arg) {
+	if constexpr (USE_OCC_COLD) {
+		co_return co_await occ_execute(arg);
+	}
 	arg.id.field.valid = false;
-	ts = ts_factory.get();
+	ctx->ts = txn_ts(arg);
+	ctx->abort_key = RetryScheduler::NO_KEY;
+	ctx->replica_writes.clear();
+	if (USE_SNAPSHOT_READS && snapshot_eligible(arg)) {
+		RC ret = co_await snapshot_execute(arg);
+		this->n_commits += ret == RC::COMMIT;
+		this->n_aborts += ret == RC::ROLLBACK;
+		co_return ret;
+	}
+	if (USE_OPTIMISTIC_READ_ONLY && arg.read_only) {
+		co_return co_await read_only_execute(arg);
+	}
+	if (USE_LOCAL_FAST_PATH && arg.all_local) {
+		co_return run_local<false>(arg, nullptr);
+	}
 	// std::stringstream ss;
-	// ss << "Starting txn tid=" << tid << " ts=" << ts << '\n';
+	// ss << "Starting txn tid=" << tid << " ts=" << ctx->ts << '\n';
 	// std::cout << ss.str();
 
 	// acquire all locks first, ex and shared. Can rollback within loop
-	TupleFuture<KV>* ops[N_OPS];
+	TupleFuture<KV>* ops[N_OPS] = {};
+	if (USE_PIPELINED_GETS && !co_await acquire_pipelined(arg, ops)) {
+        this->n_aborts += 1;
+		co_return co_await rollback();
+	}
 	for (size_t i = 0; auto& op : arg.cold_ops) {
-		if (op.mode == AccessMode::WRITE) {
-			ops[i] = write(kvs, op, arg.id);
-		} else if (op.mode == AccessMode::READ) {
-			ops[i] = read(kvs, op, arg.id);
+		if (ops[i]) {
+			// already locked by acquire_pipelined or the multi-get of an earlier op
+		} else if ((USE_MULTI_GET || USE_FUNCTION_SHIPPING) && op.mode != AccessMode::INVALID && !op.loc_info.is_local) {
+			ops[i] = co_await multi_get(kvs, arg, i, ops);
+		} else if (op.mode == AccessMode::WRITE || op.mode == AccessMode::READ) {
+			ops[i] = co_await lock(kvs, op, arg.id);
 		} else {
 			// fprintf(stderr, "i: %lu, id: %lu\n", i, arg.loader_id);
 			assert(ORIG_MODE && op.mode == AccessMode::INVALID);
 			break;
 		}
 
-		if (!ops[i]) {
+		if (!ops[i] || cc::is_wounded(tid, ctx->ts)) {
+			if (ctx->abort_key == RetryScheduler::NO_KEY) {
+				ctx->abort_key = op.id;
+			}
+            this->n_aborts += 1;
+			co_return co_await rollback();
+		}
+		if (USE_READ_REPLICAS && op.loc_info.replicated && op.mode == AccessMode::WRITE && !co_await lock_replicas(kvs, op, i, arg.id)) {
+			ctx->abort_key = op.id;
             this->n_aborts += 1;
-			return rollback();
+			co_return co_await rollback();
 		}
 		++i;
 	}
@@ -134,14 +198,17 @@ RC TxnExecutor::execute(Txn& arg) {
 			auto x = ops[i]->get();
 			if (!x) {
                 this->n_aborts += 1;
-				return rollback();
+				co_return co_await rollback();
 			}
 			x->value = op.value;
+			if (USE_READ_REPLICAS && op.loc_info.replicated) {
+				write_replicas(i, op.value, std::nullopt);
+			}
 		} else if (op.mode == AccessMode::READ) {
 			const auto x = ops[i]->get();
 			if (!x) {
                 this->n_aborts += 1;
-				return rollback();
+				co_return co_await rollback();
 			}
 			const auto value = x->value;
 			do_not_optimize(value);
@@ -160,11 +227,283 @@ RC TxnExecutor::execute(Txn& arg) {
 
 	// locks automatically released
     this->n_commits += 1;
-	return commit();
+	co_return co_await commit();
+}
+
+/*	A txn whose cold ops are all on this node never waits for a message, so it needs no future,
+	undo log or put responses: rows are latched directly and released from a stack array.
+	MINI_BATCH selects the my_execute flavour (flow order, hot send slot) over execute's. */
+template <bool MINI_BATCH>
+RC TxnExecutor::run_local(Txn& arg, void** packet_fill) {
+	struct held_t {
+		StructTable::Row_t* row;
+		const Txn::OP* op;
+		TxnId last_acq;
+	};
+	held_t held[N_OPS];
+	size_t n_held = 0;
+
+	// an aborted txn leaves the rows' last acquirer as it found it.
+	auto release = [&](bool committed) {
+		for (size_t h = n_held; h-- > 0;) {
+			TxnId release_id = MINI_BATCH && committed ? arg.id : held[h].last_acq;
+			auto rc = held[h].row->local_unlock(held[h].op->mode, ctx->ts, kvs->comm, release_id);
+			(void)rc;
+		}
+	};
+	auto abort = [&](db_key_t key) {
+		release(false);
+		ctx->abort_key = key;
+		if constexpr (MINI_BATCH) {
+			struct timespec ts_curr;
+			int rc = clock_gettime(CLOCK_MONOTONIC, &ts_curr);
+			assert(rc == 0);
+			t_abort += micros_diff(&ctx->ts_txn_begin, &ts_curr);
+		} else {
+			this->n_aborts += 1;
+		}
+		return RC::ROLLBACK;
+	};
+
+	for (size_t i = 0; i<N_OPS && arg.cold_ops[i].mode != AccessMode::INVALID; ++i) {
+		const Txn::OP& op = arg.cold_ops[i];
+		if constexpr (MINI_BATCH && USE_LOCK_AHEAD) {
+			db.lock_ahead.wait(arg, i);
+		}
+		TxnId last_acq;
+		auto row = kvs->latch(op.id, op.mode, ctx->ts, arg.id, last_acq);
+		if (row) {
+			held[n_held++] = {row, &op, last_acq};
+		}
+		if (!row || cc::is_wounded(tid, ctx->ts)) {
+			return abort(op.id);
+		}
+		if (op.mode == AccessMode::READ) {
+			const auto value = row->tuple.value;
+			do_not_optimize(value);
+		}
+	}
+
+	// writes only once every row is latched, so an abort has nothing to undo.
+	for (size_t h = 0; h < n_held; ++h) {
+		if (held[h].op->mode == AccessMode::WRITE) {
+			held[h].row->tuple.value = held[h].op->value;
+		}
+	}
+
+	if constexpr (MINI_BATCH) {
+		*packet_fill = db.hot_send_q.alloc_slot(mini_batch_num, &arg);
+	} else if (arg.do_accel) {
+		atomic(p4_switch, arg);
+	}
+	// my_execute stamps the rows with its own id, so later mini-batches see the flow order.
+	release(true);
+
+	if constexpr (MINI_BATCH) {
+		struct timespec ts_curr;
+		int rc = clock_gettime(CLOCK_MONOTONIC, &ts_curr);
+		assert(rc == 0);
+		t_commit += micros_diff(&ctx->ts_txn_begin, &ts_curr);
+	} else {
+		this->n_commits += 1;
+	}
+	return RC::COMMIT;
+}
+
+/*	Silo-style execution of a cold txn: reads record the row version instead of taking a
+	shared lock, writes are buffered and only lock their rows at commit, after which the
+	read set is validated and the writes are installed. */
+coro::task<RC> TxnExecutor::occ_execute(Txn& arg) {
+	arg.id.field.valid = false;
+	ctx->ts = txn_ts(arg);
+	ctx->replica_writes.clear();
+
+	struct occ_read_t {
+		const Txn::OP* op;
+		uint32_t version;
+	};
+	occ_read_t reads[N_OPS];
+	const Txn::OP* writes[N_OPS];
+	size_t n_reads = 0, n_writes = 0;
+
+	for (auto& op : arg.cold_ops) {
+		if (op.mode == AccessMode::WRITE) {
+			writes[n_writes++] = &op;
+			continue;
+		} else if (op.mode != AccessMode::READ) {
+			assert(ORIG_MODE && op.mode == AccessMode::INVALID);
+			break;
+		}
+
+		KV tuple;
+		uint32_t version;
+		if (!co_await occ_read(kvs, op, arg.id, tuple, version)) {
+            this->n_aborts += 1;
+			co_return co_await rollback();
+		}
+		const auto value = tuple.value;
+		do_not_optimize(value);
+		reads[n_reads++] = {&op, version};
+	}
+
+	// lock the write set, in key order so concurrent committers see the same order.
+	std::sort(&writes[0], &writes[n_writes], [](const Txn::OP* a, const Txn::OP* b) {
+		return a->id < b->id;
+	});
+	TupleFuture<KV>* locked[N_OPS];
+	for (size_t i = 0; i < n_writes; ++i) {
+		locked[i] = co_await lock(kvs, *writes[i], arg.id);
+		if (locked[i] && USE_READ_REPLICAS && writes[i]->loc_info.replicated && !co_await lock_replicas(kvs, *writes[i], i, arg.id)) {
+			locked[i] = nullptr;
+		}
+		if (!locked[i]) {
+            this->n_aborts += 1;
+			co_return co_await rollback();
+		}
+	}
+
+	for (size_t i = 0; i < n_reads; ++i) {
+		// a key we also write was validated by the version its lock returned.
+		const TupleFuture<KV>* own = nullptr;
+		for (size_t j = 0; j < n_writes; ++j) {
+			if (writes[j]->id == reads[i].op->id) {
+				own = locked[j];
+			}
+		}
+		bool valid = own ? own->version == reads[i].version :
+			co_await occ_validate(kvs, *reads[i].op, reads[i].version);
+		if (!valid) {
+            this->n_aborts += 1;
+			co_return co_await rollback();
+		}
+	}
+
+	for (size_t i = 0; i < n_writes; ++i) {
+		locked[i]->get()->value = writes[i]->value;
+		if (USE_READ_REPLICAS && writes[i]->loc_info.replicated) {
+			write_replicas(i, writes[i]->value, std::nullopt);
+		}
+	}
+
+    if (arg.do_accel) {
+		atomic(p4_switch, arg);
+	}
+
+	// write locks released (and versions bumped) by the undolog
+    this->n_commits += 1;
+	co_return co_await commit();
+}
+
+/*	A read-only txn takes no latch and holds nothing: each read records the row version (a remote
+	one comes back with it in the single TupleGetRes), then every version is validated. A lone
+	read needs no validation. Not used by my_execute, whose read locks stamp the rows for the
+	flow order. */
+coro::task<RC> TxnExecutor::read_only_execute(Txn& arg) {
+	uint32_t versions[N_OPS];
+	size_t n = 0;
+	bool valid = true;
+	for (; valid && n<N_OPS && arg.cold_ops[n].mode != AccessMode::INVALID; ++n) {
+		KV tuple;
+		valid = co_await occ_read(kvs, arg.cold_ops[n], arg.id, tuple, versions[n]);
+		if (valid) {
+			const auto value = tuple.value;
+			do_not_optimize(value);
+		} else {
+			ctx->abort_key = arg.cold_ops[n].id;
+		}
+	}
+	for (size_t i = 0; valid && n > 1 && i<n; ++i) {
+		valid = co_await occ_validate(kvs, arg.cold_ops[i], versions[i]);
+		if (!valid) {
+			ctx->abort_key = arg.cold_ops[i].id;
+		}
+	}
+	ctx->mempool.clear();
+
+	if (!valid) {
+		this->n_aborts += 1;
+		co_return RC::ROLLBACK;
+	}
+	if (arg.do_accel) {
+		atomic(p4_switch, arg);
+	}
+	this->n_commits += 1;
+	co_return RC::COMMIT;
+}
+
+/*	A read-only txn against the snapshot of the current batch epoch: no latch, no validation,
+	and no flow order check, it serializes before every txn of the batch. The snapshot gets of
+	all remote ops go out first. Fails only if a row's copy was already replaced by a later
+	epoch, or a remote node is in another epoch. */
+coro::task<RC> TxnExecutor::snapshot_execute(Txn& arg) {
+	uint32_t epoch = snapshot_epoch.load(std::memory_order_acquire);
+	TupleFuture<KV>* remote[N_OPS] = {};
+	bool valid = true;
+
+	for (size_t i = 0; i<N_OPS && arg.cold_ops[i].mode != AccessMode::INVALID; ++i) {
+		const Txn::OP& op = arg.cold_ops[i];
+		if (op.loc_info.is_local) {
+			continue;
+		}
+		auto pkt = db.comm->make_pkt();
+		auto req = pkt->ctor<msg::TupleGetReq>(ctx->ts, kvs->id, op.id, AccessMode::READ, arg.id);
+		req->sender = db.comm->node_id;
+		req->flags = msg::TupleFlags::SNAPSHOT;
+		req->epoch = epoch;
+
+		remote[i] = ctx->mempool.allocate<TupleFuture<KV>>();
+		auto msg_id = db.msg_handler->set_new_id(req);
+		db.msg_handler->add_future(msg_id, remote[i]);
+		if constexpr (USE_PIGGYBACK_RELEASES) {
+			releases.attach(op.loc_info.target, req, req->flags);
+		}
+		db.comm->send(op.loc_info.target, pkt, tid);
+	}
+
+	for (size_t i = 0; valid && i<N_OPS && arg.cold_ops[i].mode != AccessMode::INVALID; ++i) {
+		const Txn::OP& op = arg.cold_ops[i];
+		if (!op.loc_info.is_local) {
+			continue;
+		}
+		KV tuple;
+		if (kvs->snapshot_get(op.id, tuple, epoch) != ErrorCode::SUCCESS) {
+			ctx->abort_key = op.id;
+			valid = false;
+			break;
+		}
+		const auto value = tuple.value;
+		do_not_optimize(value);
+	}
+
+	// every reply is collected, even after a failure, so no future is left behind.
+	for (size_t i = 0; i<N_OPS; ++i) {
+		if (!remote[i]) {
+			continue;
+		}
+		co_await coro::until_ready(remote[i]);
+		auto x = remote[i]->get(); // frees the pkt itself on failure
+		if (x) {
+			const auto value = x->value;
+			do_not_optimize(value);
+			remote[i]->get_pkt()->free();
+		} else if (valid) {
+			ctx->abort_key = arg.cold_ops[i].id;
+			valid = false;
+		}
+	}
+	ctx->mempool.clear();
+	co_return valid ? RC::COMMIT : RC::ROLLBACK;
+}
+
+timestamp_t TxnExecutor::txn_ts(Txn& arg) {
+	if (arg.ts == 0) {
+		arg.ts = ts_factory.get();
+	}
+	return arg.ts;
 }
 
 static constexpr size_t DELAY_US = 0;
-RC TxnExecutor::commit() {
+coro::task<RC> TxnExecutor::commit() {
 	// TODO: log should not clear until the end of a batch.
 	// TODO: now, the undolog has in the future both the value,last_acq fields to be written.
 
@@ -178,20 +517,56 @@ RC TxnExecutor::commit() {
 		assert(rc == 0);
 	} while (micros_diff(&ts_now, &ts_curr) < DELAY_US);
 
-	log.commit(ts);
-	mempool.clear();
-	return RC::COMMIT;
+	ctx->log.commit(ctx->ts);
+	if constexpr (!USE_ASYNC_COMMIT) {
+		co_await wait_put_responses();
+	}
+	ctx->mempool.clear();
+	co_return RC::COMMIT;
 }
 
-RC TxnExecutor::rollback() {
-	log.rollback(ts);
-	mempool.clear();
+coro::task<RC> TxnExecutor::rollback() {
+	ctx->log.rollback(ctx->ts);
+	if constexpr (!USE_ASYNC_COMMIT) {
+		co_await wait_put_responses();
+	}
+	ctx->mempool.clear();
 
 	// for (int i = 0; i < 128; ++i) { // abort backoff
 	//     __builtin_ia32_pause();
 	// }
 
-	return RC::ROLLBACK;
+	co_return RC::ROLLBACK;
+}
+
+// the releases sent by the undolog are acked per worker, wait for all of them.
+coro::task<bool> TxnExecutor::wait_put_responses() {
+	struct timespec ts_begin, ts_end;
+	int rc = clock_gettime(CLOCK_REALTIME, &ts_begin);
+	assert(rc == 0);
+
+	co_await coro::until([](const void* cnt) {
+		return static_cast<const TuplePutResHandler::Counter*>(cnt)->is_zero();
+	}, &db.msg_handler->putresponses.counts[tid]);
+
+	rc = clock_gettime(CLOCK_REALTIME, &ts_end);
+	assert(rc == 0);
+	log_wait_time[tid] += micros_diff(&ts_begin, &ts_end);
+	co_return true;
+}
+
+/*	Sends the piggybacked releases that found no get to ride on, and waits for the acks of every
+	release so far, so none is left behind when the workers pass a barrier. With USE_ASYNC_COMMIT
+	this is the only place the acks are waited for. A txn that touches a released row again
+	needs no ack: there is one TCP stream per node and the msg-handler applies the release
+	before the later get. */
+void TxnExecutor::drain_releases() {
+	if constexpr (USE_PIGGYBACK_RELEASES) {
+		releases.flush_all();
+	}
+	if constexpr (USE_PIGGYBACK_RELEASES || USE_ASYNC_COMMIT) {
+		coro::run_sync(wait_put_responses());
+	}
 }
 
 TupleFuture<KV>* TxnExecutor::read(StructTable* table, const Txn::OP& op, TxnId id) {
@@ -208,39 +583,23 @@ TupleFuture<KV>* TxnExecutor::read(StructTable* table, const Txn::OP& op, TxnId
 	}
 
 	if (loc_info.is_local) {
-		auto future = mempool.allocate<Future_t>();
+		auto future = ctx->mempool.allocate<Future_t>();
 		// XXX a hack, just to pass my id in.
 		future->last_acq = id;
 		// fprintf(stderr, "id: (%u,%u,%u) future->last_acq: %u\n", id.field.valid, id.field.node_id, id.field.mini_batch_id, future->last_acq.get_packed());
 		assert(!my_execute || future->last_acq.field.mini_batch_id == mini_batch_num);
-		if (!table->get(op.id, AccessMode::READ, future, ts)) [[unlikely]] {
+		if (!table->get(op.id, AccessMode::READ, future, ctx->ts)) [[unlikely]] {
 			return nullptr;
 		}
-		log.add_read(table, op.id, future); // TODO passing future necessary?
+		ctx->log.add_read(table, op.id, future); // TODO passing future necessary?
 		// this should never happen, the table->get() just set the future.
 		if (!future->get()) [[unlikely]] {
 			return nullptr;
 		} // make optional for NO_WAIT
 		return future;
 	}
-
-	AccessMode mode = AccessMode::READ;
-	auto pkt = db.comm->make_pkt();
-	auto req = pkt->ctor<msg::TupleGetReq>(ts, table->id, op.id, mode, id);
-	req->sender = db.comm->node_id;
-	req->me_pack = id.get_packed();
-
-	auto future = mempool.allocate<Future_t>();
-	auto msg_id = db.msg_handler->set_new_id(req);
-	//printf("LINE:%d Inserting for msg_id=%lu, future=%p\n", __LINE__, msg_id.value, future);
-	db.msg_handler->add_future(msg_id, future);
-
-	db.comm->send(loc_info.target, pkt, tid);
-	log.add_remote_read(future, loc_info.target);
-	if (!future->get()) [[unlikely]] {
-		return nullptr;
-	}
-	return future;
+	assert(false && "remote reads go through lock()");
+	return nullptr;
 }
 
 TupleFuture<KV>* TxnExecutor::write(StructTable* table, const Txn::OP& op, TxnId id) {
@@ -265,15 +624,15 @@ TupleFuture<KV>* TxnExecutor::write(StructTable* table, const Txn::OP& op, TxnId
 		rc = clock_gettime(CLOCK_MONOTONIC, &ts_send_s);
 		assert(rc == 0);
 
-		auto future = mempool.allocate<Future_t>();
+		auto future = ctx->mempool.allocate<Future_t>();
 		future->last_acq = id;
 		future->tuple = nullptr;
 		// fprintf(stderr, "id: (%u,%u,%u) future->last_acq: %u\n", id.field.valid, id.field.node_id, id.field.mini_batch_id, future->last_acq.get_packed());
 		assert(!my_execute || future->last_acq.field.mini_batch_id == mini_batch_num);
-		if (!table->get(op.id, AccessMode::WRITE, future, ts)) [[unlikely]] {
+		if (!table->get(op.id, AccessMode::WRITE, future, ctx->ts)) [[unlikely]] {
 			return nullptr;
 		}
-		log.add_write(table, op.id, future);
+		ctx->log.add_write(table, op.id, future);
 		if (!future->get()) [[unlikely]] {
 			return nullptr;
 		}
@@ -284,33 +643,57 @@ TupleFuture<KV>* TxnExecutor::write(StructTable* table, const Txn::OP& op, TxnId
 
 		return future;
 	}
+	assert(false && "remote writes go through lock()");
+	return nullptr;
+}
 
-	AccessMode mode = AccessMode::WRITE;
-	auto pkt = db.comm->make_pkt();
-	auto req = pkt->ctor<msg::TupleGetReq>(ts, table->id, op.id, mode, id);
-	req->sender = db.comm->node_id;
-	req->me_pack = id.get_packed();
-
-	auto future = mempool.allocate<Future_t>();
-	auto msg_id = db.msg_handler->set_new_id(req);
-	//printf("LINE:%d Inserting for msg_id=%lu, future=%p\n", __LINE__, msg_id.value, future);
-	db.msg_handler->add_future(msg_id, future);
+// locks a single op, a remote one suspends the txn until the reply is in.
+coro::task<TupleFuture<KV>*> TxnExecutor::lock(StructTable* table, const Txn::OP& op, TxnId id) {
+	if (op.loc_info.is_local) {
+		co_return op.mode == AccessMode::WRITE ? write(table, op, id) : read(table, op, id);
+	}
 
 	int rc;
 	struct timespec ts_send_s, ts_send_f;
 	rc = clock_gettime(CLOCK_MONOTONIC, &ts_send_s);
 	assert(rc == 0);
 
-	db.comm->send(loc_info.target, pkt, tid);
-	log.add_remote_write(future, loc_info.target);
+	auto future = issue_remote(table, op, id);
+	co_await coro::until_ready(future);
 	if (!future->get()) [[unlikely]] {
-		return nullptr;
+		co_return nullptr;
 	}
 
 	rc = clock_gettime(CLOCK_MONOTONIC, &ts_send_f);
 	assert(rc == 0);
 	t_comm += micros_diff(&ts_send_s, &ts_send_f);
-	
+
+	co_return future;
+}
+
+// sends the TupleGetReq of a remote op and logs its release, without waiting for the reply.
+TupleFuture<KV>* TxnExecutor::issue_remote(StructTable* table, const Txn::OP& op, TxnId id) {
+	using Future_t = TupleFuture<KV>;
+
+	auto pkt = db.comm->make_pkt();
+	auto req = pkt->ctor<msg::TupleGetReq>(ctx->ts, table->id, op.id, op.mode, id);
+	req->sender = db.comm->node_id;
+	req->me_pack = id.get_packed();
+
+	auto future = ctx->mempool.allocate<Future_t>();
+	auto msg_id = db.msg_handler->set_new_id(req);
+	//printf("LINE:%d Inserting for msg_id=%lu, future=%p\n", __LINE__, msg_id.value, future);
+	db.msg_handler->add_future(msg_id, future);
+
+	if constexpr (USE_PIGGYBACK_RELEASES) {
+		releases.attach(op.loc_info.target, req, req->flags);
+	}
+	db.comm->send(op.loc_info.target, pkt, tid);
+	if (op.mode == AccessMode::WRITE) {
+		ctx->log.add_remote_write(future, op.loc_info.target);
+	} else {
+		ctx->log.add_remote_read(future, op.loc_info.target);
+	}
 	return future;
 }
 
@@ -319,17 +702,371 @@ TupleFuture<KV>* TxnExecutor::insert(StructTable* table) {
 	db_key_t key;
 	table->insert(key);
 
-	auto future = mempool.allocate<Future_t>();
-	if (!table->get(key, AccessMode::WRITE, future, ts)) [[unlikely]] {
+	auto future = ctx->mempool.allocate<Future_t>();
+	if (!table->get(key, AccessMode::WRITE, future, ctx->ts)) [[unlikely]] {
 		return nullptr;
 	}
-	log.add_write(table, key, future);
+	ctx->log.add_write(table, key, future);
 	if (!future->get()) [[unlikely]] {
 		return nullptr;
 	}
 	return future;
 }
 
+/*	Locks cold_ops[first] together with every later remote op of the txn on the same node (up to
+	MULTI_GET_MAX_KEYS) in one round trip. On success, fills ops[] for all of them and returns the
+	future of the first, otherwise nothing is held and nullptr is returned. */
+coro::task<TupleFuture<KV>*> TxnExecutor::multi_get(StructTable* table, Txn& arg, size_t first, TupleFuture<KV>** ops) {
+	bool issued[N_OPS];
+	for (size_t j = 0; j<N_OPS; ++j) {
+		issued[j] = ops[j] != nullptr;
+	}
+	pending_multi_t pending;
+	multi_get_issue(table, arg, first, issued, pending);
+
+	int rc;
+	struct timespec ts_send_s, ts_send_f;
+	rc = clock_gettime(CLOCK_MONOTONIC, &ts_send_s);
+	assert(rc == 0);
+
+	co_await coro::until_ready(pending.future);
+
+	rc = clock_gettime(CLOCK_MONOTONIC, &ts_send_f);
+	assert(rc == 0);
+	t_comm += micros_diff(&ts_send_s, &ts_send_f);
+
+	co_return multi_get_wait(pending, ops);
+}
+
+void TxnExecutor::multi_get_issue(StructTable* table, Txn& arg, size_t first, bool* issued, pending_multi_t& pending) {
+	if constexpr (USE_FUNCTION_SHIPPING) {
+		fragment_issue(table, arg, first, issued, pending);
+		return;
+	}
+	pending.target = arg.cold_ops[first].loc_info.target;
+
+	auto pkt = db.comm->make_pkt();
+	auto req = pkt->ctor<msg::TupleMultiGetReq>(ctx->ts, table->id, arg.id);
+	req->sender = db.comm->node_id;
+	for (size_t j = first; j<N_OPS && req->n<MULTI_GET_MAX_KEYS; ++j) {
+		const Txn::OP& op = arg.cold_ops[j];
+		if (op.mode == AccessMode::INVALID) {
+			break;
+		}
+		if (!issued[j] && !op.loc_info.is_local && op.loc_info.target == pending.target) {
+			pending.op_idx[req->n] = j;
+			issued[j] = true;
+			req->add(op.id, op.mode);
+		}
+	}
+
+	pending.future = ctx->mempool.allocate<AbstractFuture>();
+	auto msg_id = db.msg_handler->set_new_id(req);
+	db.msg_handler->add_future(msg_id, pending.future);
+	if constexpr (USE_PIGGYBACK_RELEASES) {
+		releases.attach(pending.target, req, req->flags);
+	}
+	db.comm->send(pending.target, pkt, tid);
+}
+
+TupleFuture<KV>* TxnExecutor::multi_get_wait(pending_multi_t& pending, TupleFuture<KV>** ops) {
+	using Future_t = TupleFuture<KV>;
+	if constexpr (USE_FUNCTION_SHIPPING) {
+		return fragment_wait(pending, ops);
+	}
+
+	auto res_pkt = pending.future->get_pkt();
+	auto res = res_pkt->as<msg::TupleMultiGetRes>();
+	if (res->failed != msg::TupleMultiGetRes::NONE) {
+		// the remote already released whatever it had granted.
+		ctx->abort_key = res->entries[res->failed].rid;
+		res_pkt->free();
+		return nullptr;
+	}
+
+	Future_t* futures[MULTI_GET_MAX_KEYS];
+	for (uint8_t k = 0; k < res->n; ++k) {
+		futures[k] = ctx->mempool.allocate<Future_t>(reinterpret_cast<KV*>(res->tuple(k, sizeof(KV))));
+		futures[k]->last_acq = TxnId(res->entries[k].last_acq_pack);
+		futures[k]->version = res->entries[k].version;
+		ops[pending.op_idx[k]] = futures[k];
+	}
+	ctx->log.add_remote_multi(pending.future, futures, pending.target);
+	return futures[0];
+}
+
+/*	Ships the ops of arg on the node of op first (and not yet in issued) as one fragment, which
+	the node runs on its own. The write values go along, only their old values come back. */
+void TxnExecutor::fragment_issue(StructTable* table, Txn& arg, size_t first, bool* issued, pending_multi_t& pending) {
+	pending.target = arg.cold_ops[first].loc_info.target;
+
+	auto pkt = db.comm->make_pkt();
+	auto req = pkt->ctor<msg::TupleFragmentReq>(ctx->ts, table->id, arg.id);
+	req->sender = db.comm->node_id;
+	for (size_t j = first; j<N_OPS && req->n<MULTI_GET_MAX_KEYS; ++j) {
+		const Txn::OP& op = arg.cold_ops[j];
+		if (op.mode == AccessMode::INVALID) {
+			break;
+		}
+		if (!issued[j] && !op.loc_info.is_local && op.loc_info.target == pending.target) {
+			pending.op_idx[req->n] = j;
+			issued[j] = true;
+			req->add(op.id, op.mode, op.value);
+		}
+	}
+
+	pending.future = ctx->mempool.allocate<AbstractFuture>();
+	auto msg_id = db.msg_handler->set_new_id(req);
+	db.msg_handler->add_future(msg_id, pending.future);
+	if constexpr (USE_PIGGYBACK_RELEASES) {
+		releases.attach(pending.target, req, req->flags);
+	}
+	db.comm->send(pending.target, pkt, tid);
+}
+
+/*	The ops of a fragment that voted commit get futures on a local copy of the values the
+	reply carries, so the write-back loops of the callers run unchanged (writes land in the
+	copy, the node already has them). */
+TupleFuture<KV>* TxnExecutor::fragment_wait(pending_multi_t& pending, TupleFuture<KV>** ops) {
+	using Future_t = TupleFuture<KV>;
+
+	auto res_pkt = pending.future->get_pkt();
+	auto res = res_pkt->as<msg::TupleFragmentRes>();
+	if (res->failed != msg::TupleFragmentRes::NONE) {
+		// the node already undid and released whatever it had run.
+		ctx->abort_key = res->entries[res->failed].rid;
+		res_pkt->free();
+		return nullptr;
+	}
+
+	Future_t* futures[MULTI_GET_MAX_KEYS];
+	for (uint8_t k = 0; k < res->n; ++k) {
+		KV* tuple = ctx->mempool.allocate<KV>(res->entries[k].rid, res->values[k]);
+		futures[k] = ctx->mempool.allocate<Future_t>(tuple);
+		futures[k]->last_acq = TxnId(res->entries[k].last_acq_pack);
+		futures[k]->version = res->entries[k].version;
+		ops[pending.op_idx[k]] = futures[k];
+	}
+	ctx->log.add_remote_fragment(pending.future, futures, pending.target);
+	return futures[0];
+}
+
+/*	Split-phase lock acquisition: send the gets of all remote ops first, lock the local ones while
+	those are in flight, then collect the replies in arrival order. Returns false as soon as any
+	lock failed, after waiting out (by yielding) the replies that are still outstanding. */
+coro::task<bool> TxnExecutor::acquire_pipelined(Txn& arg, TupleFuture<KV>** ops) {
+	size_t remote_idx[N_OPS];
+	size_t n_remote = 0;
+	pending_multi_t multis[N_OPS];
+	size_t n_multis = 0;
+	bool issued[N_OPS] = {};
+
+	for (size_t i = 0; i<N_OPS && arg.cold_ops[i].mode != AccessMode::INVALID; ++i) {
+		const Txn::OP& op = arg.cold_ops[i];
+		if (op.loc_info.is_local || issued[i]) {
+			continue;
+		}
+		if constexpr (USE_MULTI_GET || USE_FUNCTION_SHIPPING) {
+			multi_get_issue(kvs, arg, i, issued, multis[n_multis++]);
+		} else {
+			ops[i] = issue_remote(kvs, op, arg.id);
+			issued[i] = true;
+			remote_idx[n_remote++] = i;
+		}
+	}
+
+	bool success = true;
+	for (size_t i = 0; i<N_OPS && arg.cold_ops[i].mode != AccessMode::INVALID; ++i) {
+		const Txn::OP& op = arg.cold_ops[i];
+		if (!op.loc_info.is_local) {
+			continue;
+		}
+		if constexpr (USE_LOCK_AHEAD) {
+			db.lock_ahead.wait(arg, i);
+		}
+		ops[i] = co_await lock(kvs, op, arg.id);
+		if (!ops[i] || cc::is_wounded(tid, ctx->ts)) {
+			ctx->abort_key = op.id;
+			success = false;
+			break;
+		}
+	}
+
+	int rc;
+	struct timespec ts_wait_s, ts_wait_f;
+	rc = clock_gettime(CLOCK_MONOTONIC, &ts_wait_s);
+	assert(rc == 0);
+
+	bool remote_done[N_OPS] = {};
+	bool multi_done[N_OPS] = {};
+	size_t n_pending = n_remote + n_multis;
+	while (success && n_pending > 0) {
+		size_t n_before = n_pending;
+		for (size_t r = 0; r<n_remote; ++r) {
+			if (!remote_done[r] && ops[remote_idx[r]]->ready()) {
+				remote_done[r] = true;
+				n_pending -= 1;
+				if (!ops[remote_idx[r]]->get()) {
+					ctx->abort_key = arg.cold_ops[remote_idx[r]].id;
+					success = false;
+				}
+			}
+		}
+		for (size_t m = 0; m<n_multis; ++m) {
+			if (!multi_done[m] && multis[m].future->ready()) {
+				multi_done[m] = true;
+				n_pending -= 1;
+				success &= multi_get_wait(multis[m], ops) != nullptr;
+			}
+		}
+		if (n_pending == n_before) {
+			co_await coro::yield();
+		}
+	}
+	/*	collect what is still in flight before a rollback: a granted multi-get is only logged once
+		its reply is in, and Undolog::release_remote would spin on a missing single reply, stalling
+		the other txns of this worker. */
+	for (size_t r = 0; r<n_remote; ++r) {
+		if (!remote_done[r]) {
+			co_await coro::until_ready(ops[remote_idx[r]]);
+		}
+	}
+	for (size_t m = 0; m<n_multis; ++m) {
+		if (!multi_done[m]) {
+			co_await coro::until_ready(multis[m].future);
+			multi_get_wait(multis[m], ops);
+		}
+	}
+
+	rc = clock_gettime(CLOCK_MONOTONIC, &ts_wait_f);
+	assert(rc == 0);
+	t_comm += micros_diff(&ts_wait_s, &ts_wait_f);
+
+	co_return success;
+}
+
+coro::task<bool> TxnExecutor::occ_read(StructTable* table, const Txn::OP& op, TxnId id, KV& out, uint32_t& version) {
+	using Future_t = TupleFuture<KV>;
+
+	if (op.loc_info.is_local) {
+		co_return table->optimistic_get(op.id, out, version) == ErrorCode::SUCCESS;
+	}
+
+	auto pkt = db.comm->make_pkt();
+	auto req = pkt->ctor<msg::TupleGetReq>(ctx->ts, table->id, op.id, AccessMode::READ, id);
+	req->sender = db.comm->node_id;
+	req->flags = msg::TupleFlags::OPTIMISTIC;
+
+	auto future = ctx->mempool.allocate<Future_t>();
+	auto msg_id = db.msg_handler->set_new_id(req);
+	db.msg_handler->add_future(msg_id, future);
+
+	int rc;
+	struct timespec ts_send_s, ts_send_f;
+	rc = clock_gettime(CLOCK_MONOTONIC, &ts_send_s);
+	assert(rc == 0);
+
+	if constexpr (USE_PIGGYBACK_RELEASES) {
+		releases.attach(op.loc_info.target, req, req->flags);
+	}
+	db.comm->send(op.loc_info.target, pkt, tid);
+	co_await coro::until_ready(future);
+	auto x = future->get(); // frees the pkt itself on failure
+	if (x) {
+		out = *x;
+		version = future->version;
+		// nothing is held on the remote side, so the pkt is not needed for a release.
+		future->get_pkt()->free();
+	}
+
+	rc = clock_gettime(CLOCK_MONOTONIC, &ts_send_f);
+	assert(rc == 0);
+	t_comm += micros_diff(&ts_send_s, &ts_send_f);
+
+	co_return x != nullptr;
+}
+
+coro::task<bool> TxnExecutor::occ_validate(StructTable* table, const Txn::OP& op, uint32_t version) {
+	if (op.loc_info.is_local) {
+		co_return table->validate(op.id, version);
+	}
+
+	auto pkt = db.comm->make_pkt();
+	auto req = pkt->ctor<msg::TupleValidateReq>(ctx->ts, table->id, op.id, version);
+	req->sender = db.comm->node_id;
+
+	auto future = ctx->mempool.allocate<AbstractFuture>();
+	auto msg_id = db.msg_handler->set_new_id(req);
+	db.msg_handler->add_future(msg_id, future);
+	db.comm->send(op.loc_info.target, pkt, tid);
+
+	co_await coro::until_ready(future);
+	auto res_pkt = future->get_pkt();
+	bool valid = res_pkt->as<msg::TupleValidateRes>()->mode != AccessMode::INVALID;
+	res_pkt->free();
+	co_return valid;
+}
+
+/*	Read-one/write-all for the replicated keys: a write holds the lock of every copy, so a read
+	served from any node's copy conflicts with it like with the owner's lock, and the copies
+	change in the same mini-batch order. Called once the owner's copy is locked, the gets for
+	the remote copies all go out before any reply is awaited. */
+coro::task<bool> TxnExecutor::lock_replicas(StructTable* table, const Txn::OP& op, size_t op_idx, TxnId id) {
+	size_t first = ctx->replica_writes.size();
+	Txn::OP copy = op;
+	bool success = true;
+	for (uint32_t node = 0; node < Config::instance().num_nodes; ++node) {
+		if (node == op.loc_info.target || node == db.comm->node_id) {
+			continue;
+		}
+		copy.loc_info.is_local = false;
+		copy.loc_info.target = msg::node_t{node};
+		ctx->replica_writes.push_back({op_idx, issue_remote(table, copy, id), true});
+	}
+	if (!op.loc_info.is_local) {
+		copy.loc_info.is_local = true;
+		copy.loc_info.target = db.comm->node_id;
+		auto future = write(table, copy, id);
+		if (future) {
+			ctx->replica_writes.push_back({op_idx, future, false});
+		}
+		success = future != nullptr;
+	}
+
+	int rc;
+	struct timespec ts_wait_s, ts_wait_f;
+	rc = clock_gettime(CLOCK_MONOTONIC, &ts_wait_s);
+	assert(rc == 0);
+
+	// wait out every reply even after a failure, the rollback releases what was granted.
+	for (size_t r = first; r < ctx->replica_writes.size(); ++r) {
+		auto& replica = ctx->replica_writes[r];
+		if (replica.remote) {
+			co_await coro::until_ready(replica.future);
+			success &= replica.future->get() != nullptr;
+		}
+	}
+
+	rc = clock_gettime(CLOCK_MONOTONIC, &ts_wait_f);
+	assert(rc == 0);
+	t_comm += micros_diff(&ts_wait_s, &ts_wait_f);
+
+	co_return success;
+}
+
+// the written value goes to the other copies, which are released like any other lock.
+void TxnExecutor::write_replicas(size_t op_idx, uint32_t value, std::optional<TxnId> release_id) {
+	for (auto& replica : ctx->replica_writes) {
+		if (replica.op_idx != op_idx) {
+			continue;
+		}
+		replica.future->get()->value = value;
+		if (release_id) {
+			replica.future->last_acq = *release_id;
+		}
+	}
+}
+
 void TxnExecutor::atomic(SwitchInfo& p4_switch, const Txn& arg) {
     char buf[HOT_TXN_PKT_BYTES];
     p4_switch.make_txn(arg, &buf[0]);
@@ -367,9 +1104,39 @@ static void reset_db_batch(Database* db) {
 
 static size_t accel_time = 0;
 
-void TxnExecutor::run_txn(scheduler_t& sched, bool enqueue_aborts, std::queue<txn_pos_t>& q) {
+// with USE_BATCH_DEADLINE, whether the mini-batch that started at start still takes txns.
+static bool mini_batch_open(const struct timespec& start) {
+    if constexpr (!USE_BATCH_DEADLINE) {
+        return true;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t elapsed_ns = (now.tv_sec - start.tv_sec) * 1000000000LL + (now.tv_nsec - start.tv_nsec);
+    return elapsed_ns < static_cast<int64_t>(MINI_BATCH_DEADLINE_NS);
+}
+
+void TxnExecutor::run_txn(scheduler_t& sched, bool enqueue_aborts, txn_queue_t& q) {
+    txn_pos_t e;
+    if (!pop_txn(sched, q, e)) {
+        return;
+    }
+    //	TODO note this buffer is malloc-ed, seems excessive.
+    void* pkt_buf;
+
+	struct timespec ts_exec_s, ts_exec_f;
+	clock_gettime(CLOCK_MONOTONIC, &ts_exec_s);
+    RC res = coro::run_sync(my_execute(entry_to_txn(this, e), &pkt_buf));
+	clock_gettime(CLOCK_MONOTONIC, &ts_exec_f);
+	accel_time += micros_diff(&ts_exec_s, &ts_exec_f);
+
+    finish_txn(sched, enqueue_aborts, q, e, res, pkt_buf);
+}
+
+// takes the next txn off q for this mini-batch, returns false if it went to the leftovers instead.
+bool TxnExecutor::pop_txn(scheduler_t& sched, txn_queue_t& q, txn_pos_t& e) {
     assert(q.empty() == false);
-    txn_pos_t e = q.front();
+    prefetch_ahead(q);
+    e = q.front();
     Txn& txn = entry_to_txn(sched.exec, e);
     assert(txn.init_done == true);
     q.pop();
@@ -377,77 +1144,270 @@ void TxnExecutor::run_txn(scheduler_t& sched, bool enqueue_aborts, std::queue<tx
     assert(mini_batch_num > 0);
     txn.id = TxnId(true, sched.node_id, mini_batch_num);
     assert(txn.id.field.valid == true && txn.id.field.node_id == sched.node_id && txn.id.field.mini_batch_id == mini_batch_num);
-    assert(txn.init_done == true);
-    if (txn.do_accel) {
-        //	TODO note this buffer is malloc-ed, seems excessive.
-        void* pkt_buf;
+    if (!txn.do_accel) {
+        // printf("Txn %lu leftover\n", txn.loader_id);
+        this->n_cold_fallbacks += 1;
+        leftover_txns.push(e);
+        return false;
+    }
+    return true;
+}
 
-	struct timespec ts_exec_s, ts_exec_f;
-	clock_gettime(CLOCK_MONOTONIC, &ts_exec_s);
-        RC res = my_execute(txn, &pkt_buf);
-	clock_gettime(CLOCK_MONOTONIC, &ts_exec_f);
-	accel_time += micros_diff(&ts_exec_s, &ts_exec_f);
+/*	Group prefetching over the queue, which is known up front: before q.front() runs, the rows
+	of the txn PREFETCH_TXN_DISTANCE behind it are requested, and the ops of the one twice as
+	far, so that its keys are at hand when its rows are due. A fresh queue warms its first
+	PREFETCH_TXN_DISTANCE txns at once. */
+void TxnExecutor::prefetch_ahead(const txn_queue_t& q) {
+    if constexpr (!USE_ROW_PREFETCH) {
+        return;
+    }
+    constexpr size_t D = PREFETCH_TXN_DISTANCE;
+    size_t first = q.head == 0 ? 0 : D;
+    for (size_t i = first; i <= D && i < q.size(); ++i) {
+        prefetch_rows(entry_to_txn(this, q[i]));
+    }
+    for (size_t i = first + D; i <= 2*D && i < q.size(); ++i) {
+        prefetch_ops(entry_to_txn(this, q[i]));
+    }
+}
 
-        if (res == ROLLBACK) {
-            this->n_aborts += 1;
-            txn.n_aborts += 1;
-            if (enqueue_aborts && txn.n_aborts <= MAX_TIMES_ACCEL_ABORT) {
-                q.push(e);
-            } else {
-                //  convert hot into cold ops again.
-                /*  we are guaranteed this will be called for non-truncated txns, so it is safe
-                    to append to the end of cold_ops- there will be no gaps when I'm done. */
-                size_t cold_p = N_OPS-1;
-                for (size_t p = 0; p<N_OPS && 
-                        txn.hot_ops_pass1[p].first.mode != AccessMode::INVALID; ++p) {
-                    txn.cold_ops[cold_p--] = txn.hot_ops_pass1[p].first;
-                }
-                for (size_t p = 0; p<MAX_OPS_PASS2_ACCEL && 
-                        txn.hot_ops_pass2[p].first.mode != AccessMode::INVALID; ++p) {
-                    txn.cold_ops[cold_p--] = txn.hot_ops_pass1[p].first;
-                }
-                // everything should be back.
-                // assert(txn.cold_ops[N_OPS-1].mode != AccessMode::INVALID);
-                assert(txn.cold_ops[cold_p].mode != AccessMode::INVALID);
-                txn.do_accel = false;
-                this->n_cold_fallbacks += 1;
-
-                // printf("Txn %lu leftover\n", txn.loader_id);
-                leftover_txns.push(e);
+// same for the txns of the non-scheduled executor, which runs them in order.
+void TxnExecutor::prefetch_ahead(const std::vector<Txn>& txns, size_t i) {
+    if constexpr (!USE_ROW_PREFETCH) {
+        return;
+    }
+    constexpr size_t D = PREFETCH_TXN_DISTANCE;
+    for (size_t j = i == 0 ? 0 : i + D; j <= i + D && j < txns.size(); ++j) {
+        prefetch_rows(txns[j]);
+    }
+    for (size_t j = i == 0 ? D : i + 2*D; j <= i + 2*D && j < txns.size(); ++j) {
+        prefetch_ops(txns[j]);
+    }
+}
+
+void TxnExecutor::prefetch_ops(const Txn& txn) {
+    auto ops = reinterpret_cast<const char*>(txn.cold_ops.data());
+    for (size_t off = 0; off < sizeof(txn.cold_ops); off += ROW_CACHE_LINE_BYTES) {
+        __builtin_prefetch(ops + off, 0, 3);
+    }
+}
+
+void TxnExecutor::prefetch_rows(const Txn& txn) {
+    for (size_t i = 0; i < N_OPS && txn.cold_ops[i].mode != AccessMode::INVALID; ++i) {
+        kvs->prefetch(txn.cold_ops[i].id);
+    }
+}
+
+void TxnExecutor::finish_txn(scheduler_t& sched, bool enqueue_aborts, txn_queue_t& q, txn_pos_t e, RC res, void* pkt_buf) {
+    Txn& txn = entry_to_txn(sched.exec, e);
+    if constexpr (USE_LOCK_AHEAD) {
+        // the locks are released by now, let the next txns in the key queues go.
+        db.lock_ahead.release(txn);
+    }
+
+    if (res == ROLLBACK) {
+        this->n_aborts += 1;
+        retry.record_abort(ctx->abort_key);
+        requeue_aborted(enqueue_aborts, q, e);
+    } else {
+        this->n_commits += 1;
+        if (CHECK_DISJOINT_KEYS) {
+            for (size_t p = 0; p<N_OPS && txn.cold_ops[p].mode != AccessMode::INVALID; ++p) {
+                sched.touched.insert(txn.cold_ops[p].id);
             }
-        } else {
-            this->n_commits += 1;
-            if (CHECK_DISJOINT_KEYS) {
-                for (size_t p = 0; p<N_OPS && txn.cold_ops[p].mode != AccessMode::INVALID; ++p) {
-                    sched.touched.insert(txn.cold_ops[p].id);
-                }
+        }
+
+        // fprintf(stderr, "Txn %lu committed\n", txn.loader_id);
+        // fprintf(stderr, "Called make_txn from executor.\n");
+        p4_switch.make_txn(txn, pkt_buf);
+    }
+}
+
+// an aborted txn of this worker goes back into q, or to the leftovers once it aborted too often.
+void TxnExecutor::requeue_aborted(bool enqueue_aborts, txn_queue_t& q, txn_pos_t e) {
+    Txn& txn = entry_to_txn(this, e);
+    txn.n_aborts += 1;
+    if (enqueue_aborts && txn.n_aborts <= MAX_TIMES_ACCEL_ABORT) {
+        q.push(e);
+        return;
+    }
+
+    //  convert hot into cold ops again.
+    /*  we are guaranteed this will be called for non-truncated txns, so it is safe
+        to append to the end of cold_ops- there will be no gaps when I'm done. */
+    size_t cold_p = N_OPS-1;
+    for (size_t p = 0; p<N_OPS && 
+            txn.hot_ops_pass1[p].first.mode != AccessMode::INVALID; ++p) {
+        txn.cold_ops[cold_p--] = txn.hot_ops_pass1[p].first;
+    }
+    for (size_t p = 0; p<MAX_OPS_PASS2_ACCEL && 
+            txn.hot_ops_pass2[p].first.mode != AccessMode::INVALID; ++p) {
+        txn.cold_ops[cold_p--] = txn.hot_ops_pass1[p].first;
+    }
+    // everything should be back.
+    // assert(txn.cold_ops[N_OPS-1].mode != AccessMode::INVALID);
+    assert(txn.cold_ops[cold_p].mode != AccessMode::INVALID);
+    txn.do_accel = false;
+    txn.classify_cold_ops();
+    this->n_cold_fallbacks += 1;
+
+    // printf("Txn %lu leftover\n", txn.loader_id);
+    leftover_txns.push(e);
+}
+
+/*	A mini-batch with USE_WORK_STEALING: this worker's next n txns of q go into its deque, and
+	once it ran out of its own it helps the others until every deque is empty. Which txns form
+	the mini-batch is unchanged, only who runs them. */
+void TxnExecutor::run_mini_batch_stealing(scheduler_t& sched, txn_queue_t& q, size_t n) {
+    auto& deque = db.work_stealing.workers[tid]->deque;
+    // pushed back to front, so the owner takes them in queue order and thieves get the tail.
+    size_t n_mb = std::min(n, q.size());
+    for (size_t i = n_mb; i-- > 0;) {
+        deque.push(q[i]);
+    }
+    for (size_t i = 0; i < n_mb; ++i) {
+        q.pop();
+    }
+    // a worker that is through before the others published just has nothing to steal.
+
+    if constexpr (USE_CORO_EXECUTOR) {
+        run_inflight([&](inflight_slot_t& slot) {
+            if (!take_mb_txn(sched, slot.owner, slot.e)) {
+                return false;
             }
+            slot.task.emplace(my_execute((*db.per_core_txns[slot.owner])[slot.e], &slot.pkt_buf));
+            return true;
+        }, [&](inflight_slot_t& slot, RC res) {
+            finish_mb_txn(sched, q, slot.owner, slot.e, res, slot.pkt_buf);
+        });
+        return;
+    }
+    uint32_t owner;
+    txn_pos_t e;
+    while (take_mb_txn(sched, owner, e)) {
+        void* pkt_buf;
+
+        struct timespec ts_exec_s, ts_exec_f;
+        clock_gettime(CLOCK_MONOTONIC, &ts_exec_s);
+        RC res = coro::run_sync(my_execute((*db.per_core_txns[owner])[e], &pkt_buf));
+        clock_gettime(CLOCK_MONOTONIC, &ts_exec_f);
+        accel_time += micros_diff(&ts_exec_s, &ts_exec_f);
 
-            // fprintf(stderr, "Txn %lu committed\n", txn.loader_id);
-            // fprintf(stderr, "Called make_txn from executor.\n");
-            p4_switch.make_txn(txn, pkt_buf);
+        finish_mb_txn(sched, q, owner, e, res, pkt_buf);
+    }
+}
+
+// like pop_txn, from this worker's deque or, once that is empty, from another worker's.
+bool TxnExecutor::take_mb_txn(scheduler_t& sched, uint32_t& owner, txn_pos_t& e) {
+    auto& steal = db.work_stealing;
+    while (true) {
+        if (steal.workers[tid]->deque.take(e)) {
+            owner = tid;
+        } else if (!steal.steal(tid, owner, e)) {
+            return false;
+        }
+
+        Txn& txn = (*db.per_core_txns[owner])[e];
+        assert(txn.init_done == true);
+        txn.id = TxnId(true, sched.node_id, mini_batch_num);
+        if (txn.do_accel) {
+            return true;
+        }
+        if (owner == tid) {
+            this->n_cold_fallbacks += 1;
+            leftover_txns.push(e);
+        } else {
+            steal.bounce(owner, e);
         }
-    } else {
-        // printf("Txn %lu leftover\n", txn.loader_id);
-        this->n_cold_fallbacks += 1;
-        leftover_txns.push(e);
     }
 }
 
+// a stolen txn commits on the thief, anything else about it is up to its owner.
+void TxnExecutor::finish_mb_txn(scheduler_t& sched, txn_queue_t& q, uint32_t owner, txn_pos_t e, RC res, void* pkt_buf) {
+    if (owner == tid) {
+        finish_txn(sched, true, q, e, res, pkt_buf);
+        return;
+    }
+    if (res == ROLLBACK) {
+        this->n_aborts += 1;
+        retry.record_abort(ctx->abort_key);
+        db.work_stealing.bounce(owner, e);
+        return;
+    }
+    this->n_commits += 1;
+    p4_switch.make_txn((*db.per_core_txns[owner])[e], pkt_buf);
+}
+
+// after the mini-batch barrier, the txns of this worker that were stolen and handed back.
+void TxnExecutor::take_back_bounced(txn_queue_t& q) {
+    std::vector<txn_pos_t> bounced;
+    db.work_stealing.take_bounced(tid, bounced);
+    for (txn_pos_t e : bounced) {
+        if (!entry_to_txn(this, e).do_accel) {
+            this->n_cold_fallbacks += 1;
+            leftover_txns.push(e);
+        } else {
+            requeue_aborted(true, q, e);
+        }
+    }
+}
+
+/*	Runs every leftover txn to commit, in the order and at the pace the RetryScheduler picks, so
+	txns of different nodes that keep aborting each other get pulled apart. */
 void TxnExecutor::run_leftover_txns() {
-    /*  TODO potential livelock problems, what if two txns on different nodes keep aborting each
-        other, and the leftover queues on both are very small, so they have no chance to separate? */
-    size_t n_orig = leftover_txns.size();
-    while (leftover_txns.size() > n_orig/100) {
+    while (!fenced_txns.empty()) {
+        leftover_txns.push(fenced_txns.front());
+        fenced_txns.pop();
+    }
+    while (!leftover_txns.empty()) {
+        txn_pos_t e = leftover_txns.front();
+        leftover_txns.pop();
+        retry.push(e, entry_to_txn(this, e));
+    }
+    run_retries();
+    retry.end_batch();
+    drain_releases();
+}
+
+/*	While the leader streams the hot period, the switch holds the hot keys. The leftovers that
+	touch none of them run already, the others are fenced off until run_leftover_txns. */
+void TxnExecutor::run_unfenced_leftovers(DeclusteredLayout* layout) {
+    while (!leftover_txns.empty()) {
         txn_pos_t e = leftover_txns.front();
-        Txn& txn = entry_to_txn(this, e);
-        RC result = execute(txn);
-        if (result == ROLLBACK) {
-            leftover_txns.push(e);
-	}
         leftover_txns.pop();
+        Txn& txn = entry_to_txn(this, e);
+        bool hot = false;
+        for (size_t i = 0; i<N_OPS && txn.cold_ops[i].mode != AccessMode::INVALID && !hot; ++i) {
+            hot = layout->is_hot(txn.cold_ops[i].id);
+        }
+        if (hot) {
+            fenced_txns.push(e);
+        } else {
+            retry.push(e, txn);
+        }
+    }
+    run_retries();
+    drain_releases();
+}
+
+// runs what the RetryScheduler holds until all of it committed.
+void TxnExecutor::run_retries() {
+    if constexpr (USE_CORO_EXECUTOR) {
+        run_inflight([&](inflight_slot_t& slot) {
+            if (!retry.pop(slot.retry, false)) {
+                return false;
+            }
+            slot.task.emplace(execute(entry_to_txn(this, slot.retry.pos)));
+            return true;
+        }, [&](inflight_slot_t& slot, RC result) {
+            retry.done(slot.retry, result == COMMIT, ctx->abort_key);
+        });
+    }
+    RetryScheduler::entry_t entry;
+    while (retry.pop(entry, true)) {
+        RC result = coro::run_sync(execute(entry_to_txn(this, entry.pos)));
+        retry.done(entry, result == COMMIT, ctx->abort_key);
     }
-    while (leftover_txns.size() > 0) leftover_txns.pop();
 }
 
 void single_db_section(void* arg) {
@@ -466,11 +1426,25 @@ void single_db_section(void* arg) {
     tb->t_leftover += micros_diff(&ts_begin, &ts_end);
 }
 
+/*	The workers other than the leader have nothing to do during the hot period, so they schedule
+	the next batch of every worker then, the leader's included, instead of each worker doing so
+	on the critical path at the start of the batch. The queues are empty after the drain. Only
+	the switch block is not known yet, so the hot ops are rebased once the batch starts. */
+static void prepare_next_batches(Database& db, size_t start, size_t len) {
+    uint32_t w;
+    while ((w = db.prep_next.fetch_add(1, std::memory_order_relaxed)) < db.n_threads) {
+        std::vector<Txn>& txns = *db.per_core_txns[w];
+        if (start < txns.size()) {
+            db.per_core_sched[w]->sched_batch(txns, start, start+len);
+            db.per_core_sched[w]->prepared = true;
+        }
+    }
+}
+
 extern std::vector<uint64_t> wait_workers_times[32];
 extern uint64_t wait_workers_time[32];
 extern uint64_t wait_nodes_time[32];
 extern uint64_t crit_wait_time[32];
-extern uint64_t log_wait_time[32];
 
 void txn_executor(Database& db, std::vector<Txn>& txns) {
     int rc;
@@ -488,22 +1462,53 @@ void txn_executor(Database& db, std::vector<Txn>& txns) {
 	const size_t n_threads = config.num_txn_workers;
 
 	const size_t batch_tgt = BATCH_SIZE_TGT/n_threads;
-    const size_t mini_batch_tgt = MINI_BATCH_SIZE_TGT/n_threads;
 
     // just resize to make things simpler.
     txns.resize((txns.size() / batch_tgt) * batch_tgt);
 	assert(txns.size() % batch_tgt == 0);
     tb.my_txns = &txns;
+	db.per_core_txns[thread_id] = &txns;
 
 	scheduler_t sched(&tb);
+	db.per_core_sched[thread_id] = &sched;
 
-	for (size_t i = 0; i<txns.size(); i+=batch_tgt) {
-		size_t batch_num = i/batch_tgt;
-		sched.sched_batch(txns, i, i+batch_tgt);
+	size_t batch_len = batch_tgt;
+	for (size_t i = 0, batch_num = 0; i<txns.size(); i+=batch_len, ++batch_num) {
+		if constexpr (USE_BATCH_DEADLINE) {
+			batch_len = std::min(db.batch_deadline.batch_len, txns.size()-i);
+		}
+		struct timespec ts_batch;
+		rc = clock_gettime(CLOCK_MONOTONIC, &ts_batch);
+		assert(rc == 0);
+
+		const size_t n_mini_batches = USE_ADAPTIVE_MINI_BATCH ? db.mb_tuner.n_mini_batches : BATCH_SIZE_TGT/MINI_BATCH_SIZE_TGT;
+		const size_t mini_batch_tgt = std::max<size_t>(batch_len/n_mini_batches, 1);
+		if (!USE_BATCH_PIPELINE || !sched.prepared) {
+			sched.sched_batch(txns, i, i+batch_len);
+		} else {
+			sched.prepared = false;
+			for (size_t t = i; t<i+batch_len; ++t) {
+				if (txns[t].do_accel) {
+					rebase_hot_ops(txns[t], layout);
+				}
+			}
+		}
+		if (USE_BATCH_PIPELINE && thread_id == 0) {
+			db.prep_next.store(0, std::memory_order_relaxed);
+		}
+		if constexpr (USE_LOCK_AHEAD) {
+			db.lock_ahead.plan_batch(thread_id, sched.lock_ahead_sequence(tb.mini_batch_num, mini_batch_tgt, n_mini_batches));
+		}
+
+		// for the MiniBatchTuner, what this worker's mini-batches of the batch cost.
+		uint64_t busy_us = 0;
+		uint64_t ww_us = wait_workers_time[thread_id];
+		size_t n_run = tb.n_commits + tb.n_aborts;
+		size_t n_aborted = tb.n_aborts + tb.n_cold_fallbacks;
 
         // first run stuff easily- everyone hits soft batches- equivalent to hard.
         size_t orig_mb_num = tb.mini_batch_num;
-        while (tb.mini_batch_num - orig_mb_num < BATCH_SIZE_TGT/MINI_BATCH_SIZE_TGT) {
+        while (tb.mini_batch_num - orig_mb_num < n_mini_batches) {
             auto& q = sched.mb_queues[(tb.mini_batch_num-1) % sched.n_queues];
             size_t txn_num = 0;
             if (CHECK_DISJOINT_KEYS) {
@@ -515,14 +1520,31 @@ void txn_executor(Database& db, std::vector<Txn>& txns) {
 	    assert(rc == 0);
 
 	    size_t old_time = accel_time;
-            while (txn_num < mini_batch_tgt && !q.empty()) {
+            if constexpr (USE_WORK_STEALING) {
+                tb.run_mini_batch_stealing(sched, q, mini_batch_tgt);
+            } else if constexpr (USE_CORO_EXECUTOR) {
+                tb.run_inflight([&](inflight_slot_t& slot) {
+                    while (txn_num < mini_batch_tgt && !q.empty() && mini_batch_open(ts_bef_bar)) {
+                        txn_num += 1;
+                        if (tb.pop_txn(sched, q, slot.e)) {
+                            slot.task.emplace(tb.my_execute(entry_to_txn(&tb, slot.e), &slot.pkt_buf));
+                            return true;
+                        }
+                    }
+                    return false;
+                }, [&](inflight_slot_t& slot, RC res) {
+                    tb.finish_txn(sched, true, q, slot.e, res, slot.pkt_buf);
+                });
+            }
+            while (!USE_WORK_STEALING && txn_num < mini_batch_tgt && !q.empty() && mini_batch_open(ts_bef_bar)) {
                 /*
                 txn_pos_t e = q.front();
                 Txn& txn = entry_to_txn(sched.exec, e);
                 fprintf(stderr, "Running txn=%lu from q=%lu\n", txn.loader_id, (tb.mini_batch_num-1) % sched.n_queues);
                 */
 
-                tb.run_txn(sched, true, q);
+                // with lock-ahead an abort goes to the leftovers, a retry would not have a slot.
+                tb.run_txn(sched, !USE_LOCK_AHEAD, q);
                 txn_num += 1;
             }
             tb.mini_batch_num += 1;
@@ -532,9 +1554,14 @@ void txn_executor(Database& db, std::vector<Txn>& txns) {
 	    assert(rc == 0);
 
 	    tb.t_btwn.push_back(accel_time - old_time);
+	    busy_us += micros_diff(&ts_bef_bar, &ts_aft_bar);
 		fprintf(stderr, "T %d %d %d\n", WorkerContext::get().tid, tb.mini_batch_num, micros_diff(&ts_bef_bar, &ts_aft_bar));
 
+			tb.drain_releases();
 			db.msg_handler->barrier.wait_workers();
+			if constexpr (USE_WORK_STEALING) {
+				tb.take_back_bounced(q);
+			}
         }
 
         // drain the remaining queues over a SINGLE mini-batch. don't accelerate the rest.
@@ -546,6 +1573,11 @@ void txn_executor(Database& db, std::vector<Txn>& txns) {
             }
         }
         tb.mini_batch_num += 1;
+		tb.drain_releases();
+		if constexpr (USE_ADAPTIVE_MINI_BATCH) {
+			db.mb_tuner.add(busy_us, wait_workers_time[thread_id] - ww_us, tb.n_commits + tb.n_aborts - n_run,
+				tb.n_aborts + tb.n_cold_fallbacks - n_aborted);
+		}
 		db.msg_handler->barrier.wait_workers();
 
         // thread 0 is the leader thread.
@@ -554,11 +1586,34 @@ void txn_executor(Database& db, std::vector<Txn>& txns) {
             rc = clock_gettime(CLOCK_REALTIME, &ts_start);
             assert(rc == 0);
 
+            struct timespec ts_cold_end, ts_hot_end;
+            rc = clock_gettime(CLOCK_MONOTONIC, &ts_cold_end);
+            assert(rc == 0);
+
             db.wait_sched_ready();
 
+            /*	the other workers are past the last wait_workers, so none is running a txn. With USE_HOT_OVERLAP
+            	they start their leftovers only once hot_period_batch is stored, which is after the bump,
+            	so no local txn straddles the epoch change. */
+            if constexpr (USE_SNAPSHOT_READS) {
+                snapshot_epoch.fetch_add(1, std::memory_order_acq_rel);
+            }
+            if constexpr (USE_HOT_OVERLAP) {
+                db.hot_period_batch.store(1+batch_num, std::memory_order_release);
+            }
+
             __sync_synchronize();
             run_hot_period(tb, layout);
-            db.update_alloc(1+batch_num);
+            if constexpr (USE_BATCH_DEADLINE) {
+                rc = clock_gettime(CLOCK_MONOTONIC, &ts_hot_end);
+                assert(rc == 0);
+                auto& deadline = db.batch_deadline;
+                deadline.end_batch(db.msg_handler->barrier, batch_len, 1000*micros_diff(&ts_batch, &ts_cold_end),
+                    1000*micros_diff(&ts_cold_end, &ts_hot_end));
+                db.update_alloc(1+batch_num, deadline.cold_ns, deadline.hot_ns);
+            } else {
+                db.update_alloc(1+batch_num);
+            }
 
             db.hot_send_q.done_sending();
             __sync_synchronize();
@@ -568,6 +1623,26 @@ void txn_executor(Database& db, std::vector<Txn>& txns) {
             assert(rc == 0);
 
             fprintf(stderr, "Hot micros: %lu\n", micros_diff(&ts_start, &ts_end));
+            if constexpr (USE_ADAPTIVE_MINI_BATCH) {
+                db.mb_tuner.end_batch(db.msg_handler->barrier, micros_diff(&ts_start, &ts_end), sched.n_queues);
+            }
+        } else {
+            if constexpr (USE_HOT_OVERLAP) {
+                // the snapshot epoch has moved on by the time the leader starts the hot period.
+                while (db.hot_period_batch.load(std::memory_order_acquire) != 1+batch_num) {
+                    __builtin_ia32_pause();
+                }
+                struct timespec ts_begin, ts_end;
+                rc = clock_gettime(CLOCK_MONOTONIC, &ts_begin);
+                assert(rc == 0);
+                tb.run_unfenced_leftovers(layout);
+                rc = clock_gettime(CLOCK_MONOTONIC, &ts_end);
+                assert(rc == 0);
+                tb.t_leftover += micros_diff(&ts_begin, &ts_end);
+            }
+            if constexpr (USE_BATCH_PIPELINE) {
+                prepare_next_batches(db, i+batch_len, batch_len);
+            }
         }
 
         db.batch_bar.wait(&tb);
@@ -626,15 +1701,37 @@ void orig_txn_executor(Database& db, std::vector<Txn>& txns) {
     tb.my_txns = &txns;
 
     fprintf(stderr, "Starting main txns.\n");
-    for (size_t i = 0; i<txns.size(); ++i) {
+    size_t first_sync = 0;
+    if constexpr (USE_CORO_EXECUTOR) {
+        tb.run_inflight([&](inflight_slot_t& slot) {
+            if (first_sync == txns.size()) {
+                return false;
+            }
+            tb.prefetch_ahead(txns, first_sync);
+            slot.e = first_sync++;
+            extract_hot_cold(tb.kvs, txns[slot.e], config.decl_layout);
+            slot.task.emplace(tb.execute(txns[slot.e]));
+            return true;
+        }, [&](inflight_slot_t& slot, RC result) {
+            if (result == ROLLBACK) {
+                tb.retry.record_abort(tb.ctx->abort_key);
+                tb.leftover_txns.push(slot.e);
+            }
+        });
+    }
+    for (size_t i = first_sync; i<txns.size(); ++i) {
+        tb.prefetch_ahead(txns, i);
         extract_hot_cold(tb.kvs, txns[i], config.decl_layout);
         assert(txns[i].init_done);
-        RC result = tb.execute(txns[i]);
+        RC result = coro::run_sync(tb.execute(txns[i]));
         if (result == ROLLBACK) {
+            tb.retry.record_abort(tb.ctx->abort_key);
             tb.leftover_txns.push(i);
         }
     }
 
+    tb.drain_releases();
+
     struct timespec ts_mid;
     rc = clock_gettime(CLOCK_REALTIME, &ts_mid);
     assert(rc == 0);
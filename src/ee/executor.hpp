@@ -4,10 +4,13 @@
 #include "comm/msg.hpp"
 #include "comm/msg_handler.hpp"
 #include "ee/args.hpp"
+#include "ee/cc_policy.hpp"
+#include "ee/coro.hpp"
 #include "ee/database.hpp"
 #include "ee/defs.hpp"
 #include "ee/errors.hpp"
 #include "ee/future.hpp"
+#include "ee/retry_sched.hpp"
 #include "ee/switch.hpp"
 #include "ee/table.hpp"
 #include "utils/mempools.hpp"
@@ -19,6 +22,8 @@
 #include "main/config.hpp"
 
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <vector>
 #include <queue>
 #include <cassert>
@@ -32,6 +37,27 @@ enum RC {
 
 typedef uint32_t txn_pos_t;
 
+//	vector+head index queue, unlike std::queue a scheduled batch can be walked without popping it.
+struct txn_queue_t {
+	std::vector<txn_pos_t> v;
+	size_t head = 0;
+
+	bool empty() const { return head == v.size(); }
+	size_t size() const { return v.size() - head; }
+	txn_pos_t front() const { return v[head]; }
+	txn_pos_t operator[](size_t i) const { return v[head+i]; }
+	void push(txn_pos_t e) { v.push_back(e); }
+	void pop() {
+		if (++head == v.size()) {
+			v.clear();
+			head = 0;
+		}
+	}
+};
+
+// the batch a worker prepares ahead has to be the next BATCH_SIZE_TGT txns.
+static_assert(!(USE_BATCH_PIPELINE && USE_BATCH_DEADLINE), "batch pipelining needs a fixed batch size");
+
 struct TxnExecutor;
 struct scheduler_t {
 	size_t node_id;
@@ -41,8 +67,8 @@ struct scheduler_t {
 	size_t n_schedules;
 	size_t n_queues;
 	size_t schedule_len;
-	//	TODO: is this efficient enough? Replace with a vector+pointer.
-	std::queue<txn_pos_t>* mb_queues;
+	txn_queue_t* mb_queues;
+	bool prepared = false; // mb_queues already hold the next batch, see prepare_next_batches
     // just for debugging.
     std::unordered_set<db_key_t> touched;
 
@@ -51,23 +77,63 @@ struct scheduler_t {
 	void sched_batch(std::vector<Txn>& txns, size_t s, size_t e);
 	void print_schedules(size_t node);
     void process_touched(size_t mb_num);
+	std::vector<LockAheadTable::entry_t> lock_ahead_sequence(size_t first_mb, size_t mini_batch_tgt, size_t n_visits);
+};
+
+// a TupleMultiGetReq that was sent but whose reply was not consumed yet.
+struct pending_multi_t {
+	AbstractFuture* future;
+	msg::node_t target;
+	size_t op_idx[MULTI_GET_MAX_KEYS];
+};
+
+// per-txn state of the executor, one per in-flight txn.
+struct txn_ctx_t {
+    Undolog log;
+    StackPool<8192> mempool;
+    timestamp_t ts;
+    struct timespec ts_txn_begin;
+    db_key_t abort_key; // the key the last rollback failed on, if known
+    struct replica_write_t {
+        size_t op_idx;
+        TupleFuture<KV>* future;
+        bool remote;
+    };
+    std::vector<replica_write_t> replica_writes; // the other copies of the replicated keys written
+
+    txn_ctx_t(Communicator* comm, PendingReleases* releases) : log(comm, releases), ts(0), abort_key(RetryScheduler::NO_KEY) {}
+};
+
+struct inflight_slot_t {
+    txn_ctx_t ctx;
+    std::optional<coro::task<RC>> task;
+    coro::waiter_t waiter;
+    txn_pos_t e;
+    uint32_t owner; // worker whose txn e is, see take_mb_txn
+    RetryScheduler::entry_t retry;
+    void* pkt_buf;
+
+    inflight_slot_t(Communicator* comm, PendingReleases* releases) : ctx(comm, releases) {}
 };
 
 struct TxnExecutor {
     StructTable* kvs;
     SwitchInfo p4_switch;
     Database& db;
-    Undolog log;
-    StackPool<8192> mempool;
+    PendingReleases releases;
+    txn_ctx_t main_ctx;
+    txn_ctx_t* ctx; // of the txn that is running right now
+    std::vector<std::unique_ptr<inflight_slot_t>> inflight;
     switch_intf_t& sw_intf;
     uint32_t tid;
 	uint32_t mini_batch_num;
 
     std::vector<Txn>* my_txns;
 	std::queue<txn_pos_t> leftover_txns;
+	std::queue<txn_pos_t> fenced_txns; // leftovers held back until the hot period is over
+    RetryScheduler retry;
 
     TimestampFactory ts_factory;
-    timestamp_t ts;
 
     // stats
     size_t n_commits;
@@ -82,30 +148,113 @@ struct TxnExecutor {
     uint64_t t_send;
     uint64_t t_comm;
 
-    struct timespec ts_txn_begin;
-
     TxnExecutor(Database& db)
-        : p4_switch(db.comm->node_id), db(db), log(db.comm.get()), sw_intf(Config::instance().sw_intf), tid(WorkerContext::get().tid), mini_batch_num(1), my_txns(nullptr), n_commits(0), n_aborts(0), n_dropped(0), n_cold_fallbacks(0), t_commit(0), t_abort(0), t_local(0), t_leftover(0), t_send(0), t_comm(0) {
+        : p4_switch(db.comm->node_id), db(db), releases(db.comm.get()), main_ctx(db.comm.get(), &releases), ctx(&main_ctx), sw_intf(Config::instance().sw_intf), tid(WorkerContext::get().tid), mini_batch_num(1), my_txns(nullptr), retry(db.retry_tokens, tid), n_commits(0), n_aborts(0), n_dropped(0), n_cold_fallbacks(0), t_commit(0), t_abort(0), t_local(0), t_leftover(0), t_send(0), t_comm(0) {
         db.get_casted(KV::TABLE_NAME, kvs);
         p4_switch.table = kvs;
+        if constexpr (USE_CORO_EXECUTOR) {
+            for (size_t i = 0; i<CORO_INFLIGHT_TXNS; ++i) {
+                inflight.emplace_back(std::make_unique<inflight_slot_t>(db.comm.get(), &releases));
+            }
+        }
 	}
 
+    template <typename Next, typename Done>
+    void run_inflight(Next next, Done done);
+
     void run_leftover_txns();
-    void run_txn(scheduler_t& sched, bool enqueue_aborts, std::queue<txn_pos_t>& q);
-	RC my_execute(Txn& arg, void** packet_fill);
-    RC execute(Txn& arg);
-    RC commit();
-    RC rollback();
+    void run_unfenced_leftovers(DeclusteredLayout* layout);
+    void run_retries();
+    void run_txn(scheduler_t& sched, bool enqueue_aborts, txn_queue_t& q);
+    bool pop_txn(scheduler_t& sched, txn_queue_t& q, txn_pos_t& e);
+    void prefetch_ahead(const txn_queue_t& q);
+    void prefetch_ahead(const std::vector<Txn>& txns, size_t i);
+    static void prefetch_ops(const Txn& txn);
+    void prefetch_rows(const Txn& txn);
+    void finish_txn(scheduler_t& sched, bool enqueue_aborts, txn_queue_t& q, txn_pos_t e, RC res, void* pkt_buf);
+    void requeue_aborted(bool enqueue_aborts, txn_queue_t& q, txn_pos_t e);
+    void run_mini_batch_stealing(scheduler_t& sched, txn_queue_t& q, size_t n);
+    bool take_mb_txn(scheduler_t& sched, uint32_t& owner, txn_pos_t& e);
+    void finish_mb_txn(scheduler_t& sched, txn_queue_t& q, uint32_t owner, txn_pos_t e, RC res, void* pkt_buf);
+    void take_back_bounced(txn_queue_t& q);
+	coro::task<RC> my_execute(Txn& arg, void** packet_fill);
+    coro::task<RC> execute(Txn& arg);
+    template <bool MINI_BATCH>
+    RC run_local(Txn& arg, void** packet_fill);
+    coro::task<RC> occ_execute(Txn& arg);
+    coro::task<RC> read_only_execute(Txn& arg);
+    coro::task<RC> snapshot_execute(Txn& arg);
+    coro::task<RC> commit();
+    coro::task<RC> rollback();
+    coro::task<bool> wait_put_responses();
+    void drain_releases();
+    timestamp_t txn_ts(Txn& arg);
     void atomic(SwitchInfo& p4_switch, const Txn& arg);
     TupleFuture<KV>* read(StructTable* table, const Txn::OP& op, TxnId id);
     TupleFuture<KV>* write(StructTable* table, const Txn::OP& op, TxnId id);
     TupleFuture<KV>* insert(StructTable* table);
+    coro::task<TupleFuture<KV>*> lock(StructTable* table, const Txn::OP& op, TxnId id);
+    TupleFuture<KV>* issue_remote(StructTable* table, const Txn::OP& op, TxnId id);
+    coro::task<TupleFuture<KV>*> multi_get(StructTable* table, Txn& arg, size_t first, TupleFuture<KV>** ops);
+    void multi_get_issue(StructTable* table, Txn& arg, size_t first, bool* issued, pending_multi_t& pending);
+    TupleFuture<KV>* multi_get_wait(pending_multi_t& pending, TupleFuture<KV>** ops);
+    void fragment_issue(StructTable* table, Txn& arg, size_t first, bool* issued, pending_multi_t& pending);
+    TupleFuture<KV>* fragment_wait(pending_multi_t& pending, TupleFuture<KV>** ops);
+    coro::task<bool> acquire_pipelined(Txn& arg, TupleFuture<KV>** ops);
+    coro::task<bool> occ_read(StructTable* table, const Txn::OP& op, TxnId id, KV& out, uint32_t& version);
+    coro::task<bool> occ_validate(StructTable* table, const Txn::OP& op, uint32_t version);
+    coro::task<bool> lock_replicas(StructTable* table, const Txn::OP& op, size_t op_idx, TxnId id);
+    void write_replicas(size_t op_idx, uint32_t value, std::optional<TxnId> release_id);
 };
 
+/*	Runs up to CORO_INFLIGHT_TXNS txns at once on this worker. next(slot) starts the next txn in
+	slot (sets slot.task and slot.e) and returns false once there is none left, done(slot, rc) is
+	called when one finishes. A txn waiting on a reply is only resumed once the reply is in, in
+	the meantime the other slots run. */
+template <typename Next, typename Done>
+void TxnExecutor::run_inflight(Next next, Done done) {
+    coro::waiter_t* outer = coro::cur_waiter;
+    size_t n_active = 0;
+    bool more = true;
+
+    while (more || n_active > 0) {
+        for (auto& slot_ptr : inflight) {
+            inflight_slot_t& slot = *slot_ptr;
+            std::coroutine_handle<> h;
+            if (!slot.task) {
+                if (!more || !(more = next(slot))) {
+                    continue;
+                }
+                n_active += 1;
+                h = slot.task->handle;
+            } else if (slot.waiter.ready()) {
+                h = slot.waiter.handle;
+            } else {
+                continue;
+            }
+
+            ctx = &slot.ctx;
+            coro::cur_waiter = &slot.waiter;
+            h.resume();
+
+            if (slot.task->done()) {
+                RC res = slot.task->result();
+                slot.task.reset();
+                n_active -= 1;
+                done(slot, res);
+            }
+        }
+    }
+
+    ctx = &main_ctx;
+    coro::cur_waiter = outer;
+}
+
 Txn& entry_to_txn(TxnExecutor* exec, txn_pos_t entry);
 
 void run_hot_period(TxnExecutor& exec, DeclusteredLayout* layout);
 void extract_hot_cold(StructTable* table, Txn& txn, DeclusteredLayout* layout);
+void rebase_hot_ops(Txn& txn, DeclusteredLayout* layout);
 
 void txn_executor(Database& db, std::vector<Txn>& txns);
 void orig_txn_executor(Database& db, std::vector<Txn>& txns);
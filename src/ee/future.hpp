@@ -18,6 +18,11 @@ struct AbstractFuture {
         this->pkt.store(pkt, std::memory_order_release);
     }
 
+    // the reply is in, get_pkt() will not block.
+    bool ready() const {
+        return pkt.load(std::memory_order_relaxed) != nullptr;
+    }
+
     auto get_pkt() {
         Communicator::Pkt_t* pkt;
         // Wait for pkt without generating cache misses
@@ -38,6 +43,7 @@ struct TupleFuture final : public AbstractFuture {
     std::atomic<Tuple_t*> tuple{nullptr};
     // char __cache_align[64-16];
 	TxnId last_acq;
+	uint32_t version;
 
     TupleFuture() : AbstractFuture{}, tuple(nullptr) {}
     TupleFuture(Tuple_t* tuple) : AbstractFuture{}, tuple(tuple) {}
@@ -65,6 +71,7 @@ private:
                 }
                 tuple = reinterpret_cast<Tuple_t*>(res->tuple);
 				last_acq = TxnId(res->last_acq_pack);
+				version = res->version;
                 return tuple;
             }
 
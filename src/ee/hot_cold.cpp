@@ -6,14 +6,56 @@
 #include <optional>
 #include <bitset>
 
+/*	Lock order of the cold ops: by expected conflict (dist_freq) per unit of abort cost, where a
+	remote op costs REMOTE_LOCK_COST local ones as failing after it wasted a round trip. That is
+	Smith's rule for ordering checks, so a doomed txn fails early and cheaply. Ties go local first,
+	then by key so txns lock shared keys in the same order; the sort is stable so a key touched
+	twice keeps its trace order. Also records the two hottest cold ops.
+	Kind of sketchy, since how do we know the frequency of every key? Just say in a real system,
+	we would know for some fraction of keys, and for the others I don't care. */
+static void order_cold_ops(Txn& txn, const size_t* freq, size_t n) {
+	size_t order[N_OPS];
+	for (size_t i = 0; i<n; ++i) {
+		order[i] = i;
+	}
+	auto cost = [&](size_t i) -> size_t {
+		return txn.cold_ops[i].loc_info.is_local ? 1 : REMOTE_LOCK_COST;
+	};
+	std::stable_sort(&order[0], &order[n], [&](size_t a, size_t b) {
+		size_t score_a = freq[a] * cost(b), score_b = freq[b] * cost(a);
+		if (score_a != score_b) {
+			return score_a > score_b;
+		}
+		if (cost(a) != cost(b)) {
+			return cost(a) < cost(b);
+		}
+		return txn.cold_ops[a].id < txn.cold_ops[b].id;
+	});
+
+	std::array<Txn::OP, N_OPS> sorted;
+	size_t cold1_v = 0, cold2_v = 0;
+	txn.hottest_cold_i1.reset();
+	txn.hottest_cold_i2.reset();
+	for (size_t i = 0; i<n; ++i) {
+		sorted[i] = txn.cold_ops[order[i]];
+		size_t v = freq[order[i]];
+		if (v > cold1_v) {
+			cold2_v = cold1_v;
+			txn.hottest_cold_i2 = txn.hottest_cold_i1;
+			cold1_v = v;
+			txn.hottest_cold_i1 = i;
+		} else if (v > cold2_v) {
+			cold2_v = v;
+			txn.hottest_cold_i2 = i;
+		}
+	}
+	std::copy_n(sorted.begin(), n, txn.cold_ops.begin());
+}
+
 void extract_hot_cold(StructTable* table, Txn& txn, DeclusteredLayout* layout) {
 	static_assert(MAX_PASSES_ACCEL == 1 || MAX_PASSES_ACCEL == 2);
 
-	/*	Keep track of the hottest 2 values.
-		Kind of sketchy, since how do we know the frequency of every key? Just say in a real system,
-		we would know for some fraction of keys, and for the others I don't care. */
-	size_t cold1_i, cold2_i;
-	size_t cold1_v = 0, cold2_v = 0;
+	size_t cold_freq[N_OPS];
 	size_t hot_p1 = 0, hot_p2 = 0, cold_p = 0;
 	
 	std::bitset<N_REGS> reg_usage;
@@ -28,6 +70,13 @@ void extract_hot_cold(StructTable* table, Txn& txn, DeclusteredLayout* layout) {
 	size_t i = 0;
 	while (i < N_OPS && txn.cold_ops[i].mode != AccessMode::INVALID) {
 		txn.cold_ops[i].loc_info = table->part_info.location(txn.cold_ops[i].id);
+		if (USE_READ_REPLICAS && layout->is_replicated(txn.cold_ops[i].id)) {
+			txn.cold_ops[i].loc_info.replicated = true;
+			if (txn.cold_ops[i].mode == AccessMode::READ) {
+				txn.cold_ops[i].loc_info.is_local = true;
+				txn.cold_ops[i].loc_info.target = table->part_info.my_id;
+			}
+		}
 		std::pair<bool, TupleLocation> hot_info = layout->get_location(txn.cold_ops[i].id);
 		if (hot_info.first) {
             // fprintf(stderr, "reg_id: %lu |", (size_t) hot_info.second.reg_array_id);
@@ -72,13 +121,7 @@ void extract_hot_cold(StructTable* table, Txn& txn, DeclusteredLayout* layout) {
                 }
 			}
 		} else {
-			if (hot_info.second.dist_freq > cold1_v) {
-				cold1_i = cold_p;
-				cold1_v = hot_info.second.dist_freq;
-			} else if (hot_info.second.dist_freq > cold2_v) {
-				cold2_i = cold_p;
-				cold2_v = hot_info.second.dist_freq;
-			}
+			cold_freq[cold_p] = hot_info.second.dist_freq;
 			txn.cold_ops[cold_p++] = txn.cold_ops[i];
 		}
 		i += 1;
@@ -87,13 +130,16 @@ void extract_hot_cold(StructTable* table, Txn& txn, DeclusteredLayout* layout) {
 	if (!txn.do_accel) {
 		// rollback, just copy all the hot ops to the end of the cold ops.
 		for (size_t i = 0; i<hot_p1; ++i) {
+			cold_freq[i+cold_p] = txn.hot_ops_pass1[i].second.dist_freq;
 			txn.cold_ops[i+cold_p] = txn.hot_ops_pass1[i].first;
 		}
 		for (size_t i = 0; i<hot_p2; ++i) {
+			cold_freq[i+cold_p+hot_p1] = txn.hot_ops_pass2[i].second.dist_freq;
 			txn.cold_ops[i+cold_p+hot_p1] = txn.hot_ops_pass2[i].first;
 		}
 		txn.hot_ops_pass1[0].first.mode = AccessMode::INVALID;
 		txn.hot_ops_pass2[0].first.mode = AccessMode::INVALID;
+		order_cold_ops(txn, cold_freq, cold_p+hot_p1+hot_p2);
 	} else {
 		// null-terminate all the op-lists.
 		if (cold_p < N_OPS) {
@@ -105,15 +151,25 @@ void extract_hot_cold(StructTable* table, Txn& txn, DeclusteredLayout* layout) {
 		if (MAX_PASSES_ACCEL == 2 && hot_p2 < MAX_OPS_PASS2_ACCEL) {
 			txn.hot_ops_pass2[hot_p2].first.mode = AccessMode::INVALID;
 		}
-		if (cold1_v > 0) {
-			txn.hottest_cold_i1 = cold1_i;
-		}
-		if (cold2_v > 0) {
-			txn.hottest_cold_i2 = cold2_i;
-		}
+		order_cold_ops(txn, cold_freq, cold_p);
 		assert(ORIG_MODE || (cold_p + hot_p1 + hot_p2 == N_OPS));
 	}
     // fprintf(stderr, " accel: %d\n", txn.do_accel);
+	txn.classify_cold_ops();
 	txn.init_done = true;
     assert(txn.init_done == true);
 }
+
+/*	For a txn extracted before the switch block of its batch was known (USE_BATCH_PIPELINE):
+	moves its hot ops into the current block, their slot within a block stays the same. */
+void rebase_hot_ops(Txn& txn, DeclusteredLayout* layout) {
+	const size_t base = SLOTS_PER_SCHED_BLOCK * layout->block_num.load(std::memory_order_relaxed);
+	for (size_t p = 0; p<N_OPS && txn.hot_ops_pass1[p].first.mode != AccessMode::INVALID; ++p) {
+		TupleLocation& loc = txn.hot_ops_pass1[p].second;
+		loc.reg_array_idx = base + loc.reg_array_idx % SLOTS_PER_SCHED_BLOCK;
+	}
+	for (size_t p = 0; p<MAX_OPS_PASS2_ACCEL && txn.hot_ops_pass2[p].first.mode != AccessMode::INVALID; ++p) {
+		TupleLocation& loc = txn.hot_ops_pass2[p].second;
+		loc.reg_array_idx = base + loc.reg_array_idx % SLOTS_PER_SCHED_BLOCK;
+	}
+}
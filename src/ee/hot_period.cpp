@@ -8,6 +8,8 @@
 #include <main/config.hpp>
 
 #include <array>
+#include <atomic>
+#include <thread>
 #include <utility>
 
 #include <errno.h>
@@ -20,6 +22,7 @@ static uint64_t micros_diff(struct timespec* t_start, struct timespec* t_end) {
 }
 
 static constexpr size_t SLOW_TX_DELAY = 40; //us
+static constexpr size_t MAX_IN_FLIGHT = 200;
 
 /*  TODO Why does the switch process get different # of txns? Can't be drops, since
     otherwise this would stall. I speculate it is b/c we choose not to accelerate txns
@@ -90,6 +93,77 @@ static void gen_start_end_packets(std::vector<std::pair<Txn, void*>>& start_fill
     }
 }
 
+// q[begin, end) through sockfd, in paced windows of MAX_IN_FLIGHT.
+static void send_paced(switch_intf_t& sw_intf, int sockfd, hot_send_q_t::hot_txn_entry_t* q, size_t begin, size_t end) {
+    struct mmsghdr mmsghdrs[MAX_IN_FLIGHT];
+    int rc;
+
+    for (size_t window_start = begin; window_start < end; window_start += MAX_IN_FLIGHT) {
+        size_t n = std::min(end - window_start, MAX_IN_FLIGHT);
+        for (size_t i = 0; i<n; ++i) {
+            sw_intf.prepare_msghdr(&mmsghdrs[i].msg_hdr, &q[window_start+i].iov);
+        }
+
+        struct timespec ts_now, ts_curr;
+        rc = clock_gettime(CLOCK_MONOTONIC, &ts_now);
+        assert(rc == 0);
+        do {
+            rc = clock_gettime(CLOCK_MONOTONIC, &ts_curr);
+            assert(rc == 0);
+        } while (micros_diff(&ts_now, &ts_curr) < SLOW_TX_DELAY);
+
+        ssize_t sent = sendmmsg(sockfd, &mmsghdrs[0], n, 0);
+        assert(sent == static_cast<ssize_t>(n));
+    }
+}
+
+/*	With HOT_TX_THREADS > 1, a mini-batch's part of the hot_send_q is cut into HOT_TX_THREADS
+	contiguous pieces that the leader and HOT_TX_THREADS-1 sender threads send at once, each
+	through its own socket and paced on its own. The txns of one mini-batch do not depend on each
+	other, and send() only returns once every piece is out, so the wait_nodes between mini-batches
+	still order them on the switch. The sender threads sleep outside of send(). */
+struct hot_tx_pool_t {
+    struct piece_t {
+        hot_send_q_t::hot_txn_entry_t* q;
+        size_t begin;
+        size_t end;
+    };
+
+    switch_intf_t& sw_intf;
+    std::array<piece_t, HOT_TX_THREADS> pieces;
+    std::atomic<uint32_t> round;
+    std::atomic<uint32_t> n_done;
+
+    hot_tx_pool_t(switch_intf_t& sw_intf) : sw_intf(sw_intf), round(0), n_done(0) {
+        for (size_t k = 1; k<HOT_TX_THREADS; ++k) {
+            std::thread([this, k]() {
+                uint32_t seen = 0;
+                while (true) {
+                    round.wait(seen, std::memory_order_acquire);
+                    seen = round.load(std::memory_order_acquire);
+                    send_paced(this->sw_intf, this->sw_intf.tx_sockfds[k], pieces[k].q, pieces[k].begin, pieces[k].end);
+                    n_done.fetch_add(1, std::memory_order_release);
+                }
+            }).detach();
+        }
+    }
+
+    void send(hot_send_q_t::hot_txn_entry_t* q, size_t begin, size_t end) {
+        const size_t n = end - begin;
+        for (size_t k = 0; k<HOT_TX_THREADS; ++k) {
+            pieces[k] = {q, begin + n*k/HOT_TX_THREADS, begin + n*(k+1)/HOT_TX_THREADS};
+        }
+        n_done.store(0, std::memory_order_relaxed);
+        round.fetch_add(1, std::memory_order_release);
+        round.notify_all();
+
+        send_paced(sw_intf, sw_intf.tx_sockfds[0], q, pieces[0].begin, pieces[0].end);
+        while (n_done.load(std::memory_order_acquire) != HOT_TX_THREADS-1) {
+            __builtin_ia32_pause();
+        }
+    }
+};
+
 static uint32_t past_mb_num = 1;
 
 void run_hot_period(TxnExecutor& exec, DeclusteredLayout* layout) {
@@ -111,15 +185,12 @@ void run_hot_period(TxnExecutor& exec, DeclusteredLayout* layout) {
         rc = sendmsg(sw_intf.sockfd, &msg_hdr, 0);
         assert(rc == HOT_TXN_PKT_BYTES);
     }
-    
-    constexpr size_t MAX_IN_FLIGHT = 200;
 
     exec.db.msg_handler->barrier.wait_nodes();
 
     size_t q_size = exec.db.hot_send_q.send_q_tail;
     hot_send_q_t::hot_txn_entry_t* q = exec.db.hot_send_q.send_q;
     size_t q_p = 0;
-    struct mmsghdr mmsghdrs[MAX_IN_FLIGHT];
 
     if (q_size > 0 || q[0].mini_batch_num > past_mb_num) {
 	for (size_t i = past_mb_num; i<q[0].mini_batch_num; ++i) {
@@ -127,31 +198,23 @@ void run_hot_period(TxnExecutor& exec, DeclusteredLayout* layout) {
 	}
     }
 
+    // one mini-batch at a time, the wait_nodes between them order it before the next on the switch.
     while (q_p < q_size) {
-        size_t window_start = q_p;
-        while (q_p < q_size && q[window_start].mini_batch_num == q[q_p].mini_batch_num 
-                && q_p - window_start < MAX_IN_FLIGHT) {
-            sw_intf.prepare_msghdr(&mmsghdrs[q_p-window_start].msg_hdr, &q[q_p].iov);
+        size_t mb_start = q_p;
+        while (q_p < q_size && q[q_p].mini_batch_num == q[mb_start].mini_batch_num) {
             q_p += 1;
         }
+        if constexpr (HOT_TX_THREADS > 1) {
+            static hot_tx_pool_t tx_pool(sw_intf);
+            tx_pool.send(q, mb_start, q_p);
+        } else {
+            send_paced(sw_intf, sw_intf.sockfd, q, mb_start, q_p);
+        }
+        assert(q_p == q_size || q[mb_start].mini_batch_num < q[q_p].mini_batch_num);
 
-	struct timespec ts_now, ts_curr;
-	rc = clock_gettime(CLOCK_MONOTONIC, &ts_now);
-	assert(rc == 0);
-	do {
-		rc = clock_gettime(CLOCK_MONOTONIC, &ts_curr);
-		assert(rc == 0);
-	} while (micros_diff(&ts_now, &ts_curr) < SLOW_TX_DELAY);
-
-        ssize_t sent = sendmmsg(sw_intf.sockfd, &mmsghdrs[0], q_p-window_start, 0);
-        assert(sent == q_p-window_start);
-        assert(q_p == q_size || q[window_start].mini_batch_num <= q[q_p].mini_batch_num);
-
-        if (q[window_start].mini_batch_num < q[q_p].mini_batch_num || q_p == q_size) {
-            size_t end_mb = q_p == q_size ? exec.mini_batch_num : q[q_p].mini_batch_num;
-            for (size_t i = q[window_start].mini_batch_num; i < end_mb; ++i) {
-                exec.db.msg_handler->barrier.wait_nodes();
-            }
+        size_t end_mb = q_p == q_size ? exec.mini_batch_num : q[q_p].mini_batch_num;
+        for (size_t i = q[mb_start].mini_batch_num; i < end_mb; ++i) {
+            exec.db.msg_handler->barrier.wait_nodes();
         }
     }
 
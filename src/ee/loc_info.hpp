@@ -6,4 +6,5 @@
 struct LocationInfo {
     bool is_local;
     msg::node_t target;
+    bool replicated = false; // every node has a copy, a READ is served from the local one
 };
@@ -0,0 +1,134 @@
+#include "ee/lock_ahead.hpp"
+
+#include <cassert>
+
+static void plan_section(void* arg) {
+	LockAheadTable* table = (LockAheadTable*) arg;
+	table->plan();
+}
+
+LockAheadTable::LockAheadTable(size_t n_threads) : sequences(n_threads), plan_bar(n_threads, plan_section, true), n_queues(0), n_slots(0) {}
+
+void LockAheadTable::plan_batch(uint32_t tid, std::vector<entry_t>&& seq) {
+	sequences[tid] = std::move(seq);
+	plan_bar.wait(this);
+}
+
+void LockAheadTable::plan() {
+	size_t max_slots = 0;
+	for (auto& seq : sequences) {
+		max_slots += seq.size() * N_OPS;
+	}
+	// every txn of the last batch has released its slots by now, so this is safe to reuse.
+	if (slot_done.size() < max_slots) {
+		slot_size.resize(max_slots);
+		slot_next.resize(max_slots);
+		slot_queue.resize(max_slots);
+		slot_done = std::vector<std::atomic<uint32_t>>(max_slots);
+		queue_head = std::vector<std::atomic<uint32_t>>(max_slots);
+	}
+	key_queue.clear();
+	queue_tail.clear();
+	queue_tail_mode.clear();
+	n_queues = 0;
+	n_slots = 0;
+
+	// same order the workers interleave in: mini-batch, then round-robin over workers.
+	std::vector<size_t> pos(sequences.size(), 0);
+	for (uint32_t mb = 0;; ++mb) {
+		bool progress = true;
+		while (progress) {
+			progress = false;
+			for (size_t w = 0; w<sequences.size(); ++w) {
+				auto& seq = sequences[w];
+				if (pos[w] < seq.size() && seq[pos[w]].mb == mb) {
+					plan_txn(*seq[pos[w]].txn);
+					pos[w] += 1;
+					progress = true;
+				}
+			}
+		}
+
+		bool done = true;
+		for (size_t w = 0; w<sequences.size(); ++w) {
+			assert(pos[w] == sequences[w].size() || sequences[w][pos[w]].mb > mb);
+			done &= pos[w] == sequences[w].size();
+		}
+		if (done) {
+			break;
+		}
+	}
+}
+
+void LockAheadTable::plan_txn(Txn& txn) {
+	txn.lock_ahead_slot.fill(NO_SLOT);
+
+	for (size_t i = 0; i<N_OPS && txn.cold_ops[i].mode != AccessMode::INVALID; ++i) {
+		const Txn::OP& op = txn.cold_ops[i];
+		if (!op.loc_info.is_local) {
+			continue;
+		}
+
+		// a key touched twice by the txn gets one slot, in the strongest mode.
+		bool seen = false;
+		AccessMode mode = op.mode;
+		for (size_t j = 0; j<N_OPS && txn.cold_ops[j].mode != AccessMode::INVALID; ++j) {
+			if (j != i && txn.cold_ops[j].id == op.id) {
+				seen |= j < i;
+				if (txn.cold_ops[j].mode == AccessMode::WRITE) {
+					mode = AccessMode::WRITE;
+				}
+			}
+		}
+		if (seen) {
+			continue;
+		}
+
+		auto [it, inserted] = key_queue.try_emplace(op.id, n_queues);
+		uint32_t q = it->second;
+		if (inserted) {
+			queue_tail.push_back(NO_SLOT);
+			queue_tail_mode.push_back(AccessMode::INVALID);
+			n_queues += 1;
+		}
+
+		uint32_t slot;
+		if (mode == AccessMode::READ && queue_tail_mode[q] == AccessMode::READ) {
+			slot = queue_tail[q];
+			slot_size[slot] += 1;
+		} else {
+			slot = n_slots++;
+			slot_size[slot] = 1;
+			slot_next[slot] = NO_SLOT;
+			slot_queue[slot] = q;
+			slot_done[slot].store(0, std::memory_order_relaxed);
+			if (queue_tail[q] == NO_SLOT) {
+				queue_head[q].store(slot, std::memory_order_relaxed);
+			} else {
+				slot_next[queue_tail[q]] = slot;
+			}
+			queue_tail[q] = slot;
+			queue_tail_mode[q] = mode;
+		}
+		txn.lock_ahead_slot[i] = slot;
+	}
+}
+
+void LockAheadTable::release(const Txn& txn) {
+	for (uint32_t slot : txn.lock_ahead_slot) {
+		if (slot == NO_SLOT) {
+			continue;
+		}
+		slot_done[slot].fetch_add(1, std::memory_order_acq_rel);
+
+		/*	slots can finish out of order (an aborted txn frees the ones it never reached), so
+			whoever completes the head moves it past every finished slot. */
+		std::atomic<uint32_t>& head = queue_head[slot_queue[slot]];
+		uint32_t h = head.load(std::memory_order_acquire);
+		while (h != NO_SLOT && slot_done[h].load(std::memory_order_acquire) == slot_size[h]) {
+			if (head.compare_exchange_weak(h, slot_next[h], std::memory_order_acq_rel)) {
+				h = slot_next[h];
+			}
+		}
+	}
+}
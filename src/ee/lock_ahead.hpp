@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ee/args.hpp"
+#include "ee/defs.hpp"
+#include "utils/rbarrier.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*	Calvin-style lock-ahead for the mini-batch phase. Once every worker has scheduled its part
+	of the batch, one thread walks the txns in the order they will run (mini-batch, then position,
+	then worker) and appends each local cold key to a per-key queue of slots. A slot is one writer,
+	or a run of consecutive readers. At run time a txn waits until its slot is at the head of the
+	key's queue instead of aborting on a local conflict, and frees its slots once it is done.
+	Only keys of this node are queued, remote keys keep using the cc policy. */
+// a txn spins while it waits for its slot, in-flight txns on the same worker could never release theirs.
+static_assert(!(USE_LOCK_AHEAD && USE_CORO_EXECUTOR), "lock-ahead needs one txn at a time per worker");
+
+struct LockAheadTable {
+	static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+	struct entry_t {
+		uint32_t mb; // mini-batch of the batch (0-based) the worker runs the txn in
+		Txn* txn;
+	};
+
+	std::vector<std::vector<entry_t>> sequences; // per worker, in execution order
+	reusable_barrier_t plan_bar;
+
+	// planning state, per queue
+	std::unordered_map<db_key_t, uint32_t> key_queue;
+	std::vector<uint32_t> queue_tail;
+	std::vector<AccessMode> queue_tail_mode;
+	size_t n_queues;
+
+	// per slot
+	std::vector<uint32_t> slot_size;
+	std::vector<uint32_t> slot_next;
+	std::vector<uint32_t> slot_queue;
+	std::vector<std::atomic<uint32_t>> slot_done;
+	size_t n_slots;
+
+	std::vector<std::atomic<uint32_t>> queue_head;
+
+	LockAheadTable(size_t n_threads);
+
+	// called by every worker after sched_batch, returns once the whole batch is planned.
+	void plan_batch(uint32_t tid, std::vector<entry_t>&& seq);
+	void plan();
+	void plan_txn(Txn& txn);
+
+	void wait(const Txn& txn, size_t op_i) {
+		uint32_t slot = txn.lock_ahead_slot[op_i];
+		if (slot == NO_SLOT) {
+			return;
+		}
+		const std::atomic<uint32_t>& head = queue_head[slot_queue[slot]];
+		while (head.load(std::memory_order_acquire) != slot) {
+			__builtin_ia32_pause();
+		}
+	}
+
+	// after commit or rollback, also frees the slots of keys the txn never reached.
+	void release(const Txn& txn);
+};
@@ -0,0 +1,59 @@
+#include "ee/mb_tuner.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+void MiniBatchTuner::add(uint64_t busy, uint64_t wait, uint64_t run, uint64_t aborted) {
+	busy_us.fetch_add(busy, std::memory_order_relaxed);
+	wait_us.fetch_add(wait, std::memory_order_relaxed);
+	n_run.fetch_add(run, std::memory_order_relaxed);
+	n_aborted.fetch_add(aborted, std::memory_order_relaxed);
+}
+
+/*	Too many aborts halve the mini-batches, and barrier waits that are a large share of the
+	batch double them back, but only while aborts are well below the limit, so the count does
+	not flip between two sizes. The hot period counts as time of every worker. */
+size_t MiniBatchTuner::propose(uint64_t hot_us, size_t n_queues) const {
+	uint64_t run = std::max<uint64_t>(n_run.load(std::memory_order_relaxed), 1);
+	uint64_t wait = wait_us.load(std::memory_order_relaxed);
+	uint64_t total = std::max<uint64_t>(busy_us.load(std::memory_order_relaxed) + wait + hot_us*n_workers, 1);
+	uint64_t abort_pct = 100*n_aborted.load(std::memory_order_relaxed) / run;
+	uint64_t wait_pct = 100*wait / total;
+
+	size_t n = n_mini_batches;
+	if (abort_pct > ADAPT_ABORT_PCT) {
+		n *= 2;
+	} else if (wait_pct > ADAPT_WAIT_PCT && 2*abort_pct < ADAPT_ABORT_PCT) {
+		n /= 2;
+	}
+	size_t lo = (MIN_MINI_BATCHES+n_queues-1) / n_queues * n_queues;
+	size_t hi = std::max(lo, std::min(MAX_MINI_BATCHES, BATCH_SIZE_TGT/n_workers) / n_queues * n_queues);
+	return std::clamp(n / n_queues * n_queues, lo, hi);
+}
+
+void MiniBatchTuner::end_batch(BarrierHandler& barrier, uint64_t hot_us, size_t n_queues) {
+	size_t n = barrier.wait_nodes(propose(hot_us, n_queues));
+	if (n != n_mini_batches) {
+		fprintf(stderr, "Mini-batches per batch: %lu -> %lu\n", n_mini_batches, n);
+	}
+	n_mini_batches = n;
+	busy_us.store(0, std::memory_order_relaxed);
+	wait_us.store(0, std::memory_order_relaxed);
+	n_run.store(0, std::memory_order_relaxed);
+	n_aborted.store(0, std::memory_order_relaxed);
+}
+
+void BatchDeadline::end_batch(BarrierHandler& barrier, size_t len, uint64_t batch_cold_ns, uint64_t batch_hot_ns) {
+	hot_ns = (3*hot_ns + batch_hot_ns) / 4;
+	uint64_t ns_per_txn = std::max<uint64_t>(batch_cold_ns / std::max<size_t>(len, 1), 1);
+	uint64_t budget = BATCH_DEADLINE_NS > hot_ns ? BATCH_DEADLINE_NS - hot_ns : 0;
+	size_t want = std::clamp<size_t>(budget / ns_per_txn, std::min(MIN_MINI_BATCH_THR_SIZE, max_len), max_len);
+
+	// the barrier agrees on a max, so the nodes exchange how far below max_len they want to go.
+	size_t n = max_len - barrier.wait_nodes(max_len - want);
+	if (n != batch_len) {
+		fprintf(stderr, "Batch txns per worker: %lu -> %lu\n", batch_len, n);
+	}
+	batch_len = n;
+	cold_ns = ns_per_txn * batch_len;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "comm/handlers/barrier.hpp"
+#include "ee/defs.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+/*	Picks how many mini-batches the next batch is cut into. More, smaller mini-batches mean
+	fewer txns of a mini-batch conflict in flow order, fewer mean fewer barriers. The workers add
+	up what their mini-batches cost, and between batches the leader proposes a count from that
+	and the hot period. The nodes take the largest proposal, so every node runs the same count. */
+struct MiniBatchTuner {
+	std::atomic<uint64_t> busy_us;
+	std::atomic<uint64_t> wait_us;
+	std::atomic<uint64_t> n_run;
+	std::atomic<uint64_t> n_aborted; // aborts and cold fallbacks
+	size_t n_workers;
+	size_t n_mini_batches; // of the batch that runs next
+
+	MiniBatchTuner(size_t n_workers)
+		: busy_us(0), wait_us(0), n_run(0), n_aborted(0), n_workers(n_workers), n_mini_batches(BATCH_SIZE_TGT/MINI_BATCH_SIZE_TGT) {}
+
+	void add(uint64_t busy, uint64_t wait, uint64_t run, uint64_t aborted);
+	// a multiple of n_queues, so every queue of the scheduler gets the same share of mini-batches.
+	size_t propose(uint64_t hot_us, size_t n_queues) const;
+	// leader only, while the other workers wait for the next batch.
+	void end_batch(BarrierHandler& barrier, uint64_t hot_us, size_t n_queues);
+};
+
+// a txn left over by a closed mini-batch would hold up the lock-ahead slots planned after it.
+static_assert(!(USE_BATCH_DEADLINE && USE_LOCK_AHEAD), "batch deadlines and lock-ahead do not mix");
+
+/*	How many txns per worker the next batch takes, so that its mini-batches and hot period fit
+	in BATCH_DEADLINE_NS at the rate the last batch ran. The nodes take the smallest proposal,
+	so they keep running the same number of batches. The planned durations also go to the
+	switch scheduler (Database::update_alloc) instead of the fixed estimates. */
+struct BatchDeadline {
+	const size_t max_len;
+	size_t batch_len;
+	uint64_t cold_ns; // planned for the mini-batches of the next batch
+	uint64_t hot_ns; // moving average of the hot period
+
+	BatchDeadline(size_t n_workers)
+		: max_len(BATCH_SIZE_TGT/n_workers), batch_len(max_len), cold_ns(COLD_BATCH_DUR_EST_NS), hot_ns(HOT_BATCH_DUR_EST_NS) {}
+
+	// leader only, with how long the batch of len txns per worker took up to and in the hot period.
+	void end_batch(BarrierHandler& barrier, size_t len, uint64_t batch_cold_ns, uint64_t batch_hot_ns);
+};
@@ -0,0 +1,118 @@
+#include "ee/retry_sched.hpp"
+
+#include <algorithm>
+#include <ctime>
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// min-heap on (not_before, heat)
+static bool later(const RetryScheduler::entry_t& a, const RetryScheduler::entry_t& b) {
+	if (a.not_before != b.not_before) {
+		return a.not_before > b.not_before;
+	}
+	return a.heat > b.heat;
+}
+
+uint32_t RetryScheduler::aborts(db_key_t key) const {
+	auto it = key_aborts.find(key);
+	return it == key_aborts.end() ? 0 : it->second;
+}
+
+void RetryScheduler::record_abort(db_key_t key) {
+	if (key != NO_KEY) {
+		key_aborts[key] += 1;
+	}
+}
+
+void RetryScheduler::push(uint32_t pos, const Txn& txn) {
+	db_key_t key = txn.cold_ops[txn.hottest_cold_i1.value_or(0)].id;
+	uint32_t heat = aborts(key);
+	for (size_t i = 0; i<N_OPS && txn.cold_ops[i].mode != AccessMode::INVALID; ++i) {
+		uint32_t a = aborts(txn.cold_ops[i].id);
+		if (a > heat) {
+			key = txn.cold_ops[i].id;
+			heat = a;
+		}
+	}
+	requeue(entry_t{0, heat, 0, pos, key, false});
+}
+
+void RetryScheduler::requeue(const entry_t& entry) {
+	heap.push_back(entry);
+	std::push_heap(heap.begin(), heap.end(), later);
+}
+
+bool RetryScheduler::pop(entry_t& out, bool wait) {
+	while (true) {
+		uint64_t now = now_ns();
+		bool found = false;
+		while (!heap.empty() && heap.front().not_before <= now) {
+			std::pop_heap(heap.begin(), heap.end(), later);
+			entry_t entry = heap.back();
+			heap.pop_back();
+
+			if (aborts(entry.key) >= RETRY_SERIALIZE_ABORTS) {
+				if (!tokens.try_acquire(entry.key)) {
+					blocked.push_back(entry);
+					continue;
+				}
+				entry.token = true;
+			}
+			out = entry;
+			found = true;
+			break;
+		}
+		for (auto& entry : blocked) {
+			requeue(entry);
+		}
+		blocked.clear();
+
+		if (found) {
+			return true;
+		}
+		if (heap.empty() || !wait) {
+			return false;
+		}
+		__builtin_ia32_pause();
+	}
+}
+
+void RetryScheduler::done(entry_t& entry, bool committed, db_key_t abort_key) {
+	if (entry.token) {
+		tokens.release(entry.key);
+		entry.token = false;
+	}
+	if (committed) {
+		return;
+	}
+
+	if (abort_key != NO_KEY) {
+		entry.key = abort_key;
+	}
+	record_abort(entry.key);
+	entry.heat = aborts(entry.key);
+	entry.attempts += 1;
+
+	// exponential backoff with jitter, so retries on different nodes drift apart.
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	uint64_t delay = RETRY_BACKOFF_NS << std::min<uint32_t>(entry.attempts, RETRY_BACKOFF_MAX_SHIFT);
+	entry.not_before = now_ns() + delay/2 + seed % (delay/2 + 1);
+	requeue(entry);
+}
+
+void RetryScheduler::end_batch() {
+	for (auto it = key_aborts.begin(); it != key_aborts.end();) {
+		it->second /= 2;
+		if (it->second == 0) {
+			it = key_aborts.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
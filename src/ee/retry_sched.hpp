@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ee/args.hpp"
+#include "ee/defs.hpp"
+#include "ee/types.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/*	Shared by the workers of a node. A retry of a txn whose key keeps aborting takes the token of
+	the key's stripe while it runs, so such retries go one at a time instead of aborting each
+	other again. */
+struct RetryTokens {
+	std::unique_ptr<std::atomic<bool>[]> tokens;
+
+	RetryTokens() : tokens(std::make_unique<std::atomic<bool>[]>(RETRY_TOKEN_STRIPES)) {}
+
+	static size_t stripe(db_key_t key) {
+		return (key * 0x9e3779b97f4a7c15ULL) >> 32 & (RETRY_TOKEN_STRIPES-1);
+	}
+	bool try_acquire(db_key_t key) {
+		std::atomic<bool>& token = tokens[stripe(key)];
+		return !token.load(std::memory_order_relaxed) && !token.exchange(true, std::memory_order_acquire);
+	}
+	void release(db_key_t key) {
+		tokens[stripe(key)].store(false, std::memory_order_release);
+	}
+};
+static_assert((RETRY_TOKEN_STRIPES & (RETRY_TOKEN_STRIPES-1)) == 0);
+
+/*	Orders and paces the retries of a worker's leftover txns. Each abort is charged to the key
+	it failed on, and the counts carry over to later batches (halved once per batch). A txn is
+	filed under its key with the most aborts. Txns on cooler keys go first, every retry is
+	backed off exponentially in its own attempts, and a txn on a key with RETRY_SERIALIZE_ABORTS
+	or more aborts runs only while holding the key's token. Nothing is dropped. */
+struct RetryScheduler {
+	static constexpr db_key_t NO_KEY = std::numeric_limits<db_key_t>::max();
+
+	struct entry_t {
+		uint64_t not_before; // ns, CLOCK_MONOTONIC
+		uint32_t heat; // aborts on key when it was queued
+		uint32_t attempts;
+		uint32_t pos;
+		db_key_t key;
+		bool token;
+	};
+
+	RetryTokens& tokens;
+	std::unordered_map<db_key_t, uint32_t> key_aborts;
+	std::vector<entry_t> heap;
+	std::vector<entry_t> blocked;
+	uint64_t seed;
+
+	RetryScheduler(RetryTokens& tokens, uint32_t tid) : tokens(tokens), seed(0x2545f4914f6cdd1dULL + tid) {}
+
+	bool empty() const {
+		return heap.empty();
+	}
+
+	void record_abort(db_key_t key);
+	void push(uint32_t pos, const Txn& txn);
+	// the next txn to run, false if there is none (yet). With wait, only false once empty.
+	bool pop(entry_t& out, bool wait);
+	void done(entry_t& entry, bool committed, db_key_t abort_key);
+	void end_batch();
+
+private:
+	uint32_t aborts(db_key_t key) const;
+	void requeue(const entry_t& entry);
+};
@@ -1,35 +1,215 @@
 #pragma once
 
+#include "ee/cc_policy.hpp"
 #include "ee/future.hpp"
-#include "utils/spinlock.hpp"
 #include "ee/types.hpp"
+#include "utils/spinlock.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
 #include <mutex>
-#include <tbb/queuing_mutex.h>
-#include <tbb/queuing_rw_mutex.h>
+#include <type_traits>
+#include <vector>
 
 #include <cstdio>
+#include <ctime>
+
+/*	Keep every row inside a single cache line: round the row up to a power of two so rows in
+	StructTable::data never straddle two lines. */
+static constexpr size_t ROW_CACHE_LINE_BYTES = 64;
+static constexpr size_t ROW_HEADER_BYTES = sizeof(uint64_t) + sizeof(timestamp_t);
+
+/*	Batch epochs for snapshot reads. Thread 0 advances the epoch at the start of each hot
+	period, while no local txn runs. The first writer of a row in an epoch copies the tuple
+	aside first, so the row still has its value as of the epoch start. */
+inline std::atomic<uint32_t> snapshot_epoch{1};
 
 template <typename Tuple_t>
-struct Row {
-    using lock_t = std::mutex;
-    // using lock_t = SpinLock;
-    // using lock_t = tbb::queuing_mutex;
+struct RowSnapshot {
+	std::atomic<uint32_t> epoch{0}; // the copy is the value at the start of this epoch
+	Tuple_t tuple;
+};
+struct NoRowSnapshot {};
+
+/*	Remote lock requests that found their row busy and wait for its release, instead of going
+	back refused and costing the requester a round trip and a retry. A request only parks if
+	it is older than every holder (wait-die, so parked requests never wait in a cycle), and
+	behind at most REMOTE_LOCK_QUEUE_LEN others. Whoever releases the row hands it on in
+	arrival order. A request still parked after REMOTE_LOCK_WAIT_NS is refused, checked on
+	every release of its row and by the msg-handler after every message. Keyed by row
+	address, striped, the rows themselves stay one cache line. */
+struct ParkedLocks {
+	using Pkt_t = Communicator::Pkt_t;
+	static constexpr size_t STRIPES = 1024;
+
+	struct entry_t {
+		const void* row;
+		Pkt_t* pkt; // the msg::TupleGetReq
+		uint64_t deadline;
+	};
+	struct stripe_t {
+		SpinLock lock;
+		std::vector<entry_t> parked;
+	};
+
+	std::unique_ptr<stripe_t[]> stripes;
+	std::atomic<uint32_t> n_parked{0};
+
+	ParkedLocks() : stripes(std::make_unique<stripe_t[]>(STRIPES)) {}
+
+	static uint64_t now_ns() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	stripe_t& stripe(const void* row) {
+		return stripes[(reinterpret_cast<uintptr_t>(row) / ROW_CACHE_LINE_BYTES) % STRIPES];
+	}
+
+	bool park(const void* row, Pkt_t* pkt) {
+		stripe_t& s = stripe(row);
+		std::lock_guard guard(s.lock);
+		size_t queued = std::count_if(s.parked.begin(), s.parked.end(), [&](const entry_t& e) {
+			return e.row == row;
+		});
+		if (queued == REMOTE_LOCK_QUEUE_LEN) {
+			return false;
+		}
+		s.parked.push_back(entry_t{row, pkt, now_ns() + REMOTE_LOCK_WAIT_NS});
+		n_parked.fetch_add(1, std::memory_order_release);
+		return true;
+	}
 
-    lock_t mutex;
+	// turns the parked request into its refusal.
+	static void refuse(Pkt_t* pkt) {
+		auto res = pkt->as<msg::TupleGetReq>()->convert<msg::TupleGetRes>();
+		res->mode = AccessMode::INVALID;
+	}
 
-    AccessMode lock_type = AccessMode::INVALID;
-    uint32_t owner_cnt = 0;
+	/*	grant(pkt) tries to hand the row to a parked request and returns false while the row is
+		still busy for it, which also holds up every later request on the row. The replies are
+		sent once the stripe is unlocked. */
+	template <typename Grant>
+	void wake(const void* row, Communicator& comm, Grant grant) {
+		if constexpr (!USE_REMOTE_LOCK_QUEUE) {
+			return;
+		}
+		if (n_parked.load(std::memory_order_acquire) == 0) {
+			return;
+		}
+		Pkt_t* replies[REMOTE_LOCK_QUEUE_LEN];
+		size_t n_replies = 0;
+		{
+			stripe_t& s = stripe(row);
+			std::lock_guard guard(s.lock);
+			uint64_t now = now_ns();
+			bool busy = false;
+			for (auto it = s.parked.begin(); it != s.parked.end();) {
+				if (it->row != row || (busy && it->deadline > now)) {
+					++it;
+					continue;
+				}
+				if (it->deadline <= now) {
+					refuse(it->pkt);
+				} else if (!grant(it->pkt)) {
+					busy = true;
+					++it;
+					continue;
+				}
+				replies[n_replies++] = it->pkt;
+				it = s.parked.erase(it);
+				n_parked.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+		for (size_t i = 0; i < n_replies; ++i) {
+			Pkt_t* pkt = replies[i];
+			comm.send(pkt->as<msg::Header>()->sender, pkt, comm.mh_tid);
+		}
+	}
+
+	// refuses every request whose deadline passed, from the msg-handler.
+	void expire(Communicator& comm) {
+		if (!USE_REMOTE_LOCK_QUEUE || n_parked.load(std::memory_order_acquire) == 0) {
+			return;
+		}
+		uint64_t now = now_ns();
+		for (size_t i = 0; i < STRIPES; ++i) {
+			stripe_t& s = stripes[i];
+			std::lock_guard guard(s.lock);
+			for (auto it = s.parked.begin(); it != s.parked.end();) {
+				if (it->deadline > now) {
+					++it;
+					continue;
+				}
+				Pkt_t* pkt = it->pkt;
+				refuse(pkt);
+				comm.send(pkt->as<msg::Header>()->sender, pkt, comm.mh_tid);
+				it = s.parked.erase(it);
+				n_parked.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+template <typename Tuple_t>
+constexpr size_t row_align() {
+	constexpr size_t snapshot_bytes = USE_SNAPSHOT_READS ? sizeof(RowSnapshot<Tuple_t>) : 0;
+	return std::min(ROW_CACHE_LINE_BYTES, std::bit_ceil(ROW_HEADER_BYTES + sizeof(Tuple_t) + snapshot_bytes));
+}
+
+template <typename Tuple_t>
+struct alignas(row_align<Tuple_t>()) Row {
+	/*	The whole lock state lives in one word, so acquire/release is a single CAS instead of
+		a mutex round trip.
+		[63:32] last_acq (packed TxnId) | [31:10] version | [9:2] owner_cnt | [1:0] lock_type
+		The version is bumped by every write unlock, optimistic readers validate against it. */
+	using latch_t = uint64_t;
+	static constexpr latch_t MODE_MASK = 0x3;
+	static constexpr size_t CNT_SHIFT = 2;
+	static constexpr latch_t CNT_MASK = (latch_t{1} << 8) - 1;
+	static constexpr size_t VERSION_SHIFT = 10;
+	static constexpr latch_t VERSION_MASK = (latch_t{1} << 22) - 1;
+	static constexpr size_t ACQ_SHIFT = 32;
+
+	std::atomic<latch_t> latch;
+	/*	oldest ts among the current owners, only consulted by the cc policy on a conflict. While
+		the row is shared it is a hint: it is only lowered, so it may name an owner that has left. */
+	std::atomic<timestamp_t> owner_ts;
 
     Tuple_t tuple;
-	// TODO: maybe split into reader/writer for higher concurrency?
-	TxnId last_acq;
+	[[no_unique_address]] std::conditional_t<USE_SNAPSHOT_READS, RowSnapshot<Tuple_t>, NoRowSnapshot> snap;
+
+	Row() : latch(pack(AccessMode::INVALID, 0, 0, TxnId(true, 0, 0))), owner_ts(cc::NO_TS) {}
 
-	Row() : last_acq(true, 0, 0) {}
+	enum class Acquire {
+		SUCCESS,
+		INCOMPATIBLE, // held in a conflicting mode, the cc policy may wait for it
+		FLOW_ORDER, // mb_allow_lock refused, waiting never helps
+	};
 
     using Future_t = TupleFuture<Tuple_t>;
 
-	inline bool mb_allow_lock(TxnId txn_id) {
+	static latch_t pack(AccessMode mode, uint32_t cnt, uint32_t version, TxnId acq) {
+		return (latch_t{acq.repr} << ACQ_SHIFT) | ((version & VERSION_MASK) << VERSION_SHIFT) |
+			((cnt & CNT_MASK) << CNT_SHIFT) | static_cast<latch_t>(mode);
+	}
+	static constexpr AccessMode lock_type(latch_t word) {
+		return static_cast<AccessMode>(word & MODE_MASK);
+	}
+	static constexpr uint32_t owner_cnt(latch_t word) {
+		return (word >> CNT_SHIFT) & CNT_MASK;
+	}
+	static constexpr uint32_t version(latch_t word) {
+		return (word >> VERSION_SHIFT) & VERSION_MASK;
+	}
+	static TxnId last_acq(latch_t word) {
+		return TxnId(static_cast<uint32_t>(word >> ACQ_SHIFT));
+	}
+
+	static inline bool mb_allow_lock(TxnId txn_id, TxnId last_acq) {
 		if (txn_id.field.valid) {
 			// TODO check for wrap-around!
 			assert(txn_id.field.mini_batch_id >= last_acq.field.mini_batch_id);
@@ -42,107 +222,306 @@ struct Row {
 		return true;
 	}
 
-    ErrorCode local_lock(const AccessMode mode, timestamp_t, Future_t* future) {
-        if (!is_compatible(mode)) { // early abort test
-            switch (mode) {
-                case AccessMode::READ:
-                    return ErrorCode::READ_LOCK_FAILED;
-                case AccessMode::WRITE:
-                    return ErrorCode::WRITE_LOCK_FAILED;
-                default:
-                    return ErrorCode::INVALID_ACCESS_MODE;
-            }
-        }
+	static ErrorCode lock_failed(const AccessMode mode) {
+		switch (mode) {
+			case AccessMode::READ:
+				return ErrorCode::READ_LOCK_FAILED;
+			case AccessMode::WRITE:
+				return ErrorCode::WRITE_LOCK_FAILED;
+			default:
+				return ErrorCode::INVALID_ACCESS_MODE;
+		}
+	}
+
+	/*	CAS loop shared by local and remote acquisition. On success, returns the word that was
+		replaced, so the caller can hand out the previous last_acq. */
+	Acquire try_acquire(const AccessMode mode, TxnId txn_id, timestamp_t ts, latch_t& prev) {
+		latch_t word = latch.load(std::memory_order_relaxed);
+		do {
+			if (!mb_allow_lock(txn_id, last_acq(word))) {
+				return Acquire::FLOW_ORDER;
+			}
+			// a full owner count would wrap to 0 under a READ mode, refuse like a conflict instead.
+			if (!is_compatible(lock_type(word), mode) || owner_cnt(word) == CNT_MASK) {
+				return Acquire::INCOMPATIBLE;
+			}
+		} while (!latch.compare_exchange_weak(word, pack(mode, owner_cnt(word)+1, version(word), last_acq(word)),
+				std::memory_order_acquire, std::memory_order_relaxed));
+		prev = word;
+		if (mode == AccessMode::WRITE) {
+			preserve_snapshot();
+		}
+
+		if (owner_cnt(word) == 0) {
+			owner_ts.store(ts, std::memory_order_relaxed);
+		} else {
+			timestamp_t cur = owner_ts.load(std::memory_order_relaxed);
+			while (ts < cur && !owner_ts.compare_exchange_weak(cur, ts, std::memory_order_relaxed)) {}
+		}
+		return Acquire::SUCCESS;
+	}
 
-        const std::lock_guard<lock_t> lock(mutex);
+	// latches the row for a local txn, waiting as far as the cc policy allows.
+	ErrorCode latch_local(const AccessMode mode, timestamp_t ts, TxnId txn_id, latch_t& prev) {
+		for (size_t spins = 0;; ++spins) {
+			Acquire rc = try_acquire(mode, txn_id, ts, prev);
+			if (rc == Acquire::SUCCESS) {
+				return ErrorCode::SUCCESS;
+			}
+			if (rc == Acquire::FLOW_ORDER ||
+				!cc::should_wait(ts, owner_ts.load(std::memory_order_relaxed), spins, true)) {
+				return lock_failed(mode);
+			}
+			__builtin_ia32_pause();
+		}
+	}
 
+    ErrorCode local_lock(const AccessMode mode, timestamp_t ts, Future_t* future) {
 		// TODO last_acq is a bad name, maybe use a union in the future?
-		TxnId txn_id = future->last_acq;
-		bool allow_lock = mb_allow_lock(txn_id);
-        if (!is_compatible(mode) || !allow_lock) {
-            switch (mode) {
-                case AccessMode::READ:
-                    return ErrorCode::READ_LOCK_FAILED;
-                case AccessMode::WRITE:
-                    return ErrorCode::WRITE_LOCK_FAILED;
-                default:
-                    return ErrorCode::INVALID_ACCESS_MODE;
-            }
-        }
+		latch_t prev;
+		if (ErrorCode rc = latch_local(mode, ts, future->last_acq, prev); rc != ErrorCode::SUCCESS) {
+			return rc;
+		}
 
-        ++owner_cnt;
-        lock_type = mode;
         future->tuple.store(&tuple);
-		future->last_acq = last_acq;
+		future->last_acq = last_acq(prev);
+		future->version = version(prev);
 
         return ErrorCode::SUCCESS;
     }
 
-    void remote_lock(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleGetReq* req) {
-        const std::lock_guard<lock_t> lock(mutex);
+	// acquisition on behalf of a remote txn, from the msg-handler.
+	Acquire remote_try_acquire(const AccessMode mode, TxnId txn_id, timestamp_t ts, latch_t& prev) {
+		Acquire rc = try_acquire(mode, txn_id, ts, prev);
+		if (rc == Acquire::INCOMPATIBLE) {
+			// the msg-handler never spins, but an older requester may still wound.
+			bool wait = cc::should_wait(ts, owner_ts.load(std::memory_order_relaxed), 0, false);
+			(void)wait;
+		}
+		return rc;
+	}
 
-		TxnId txn_id(req->me_pack);
-		bool allow_lock = mb_allow_lock(txn_id);
-        if (!is_compatible(req->mode) || !allow_lock) {
+	bool remote_acquire(const AccessMode mode, TxnId txn_id, timestamp_t ts, latch_t& prev) {
+		return remote_try_acquire(mode, txn_id, ts, prev) == Acquire::SUCCESS;
+	}
+
+    void remote_lock(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleGetReq* req) {
+		latch_t prev;
+		Acquire rc = remote_try_acquire(req->mode, TxnId(req->me_pack), req->ts, prev);
+		if constexpr (USE_REMOTE_LOCK_QUEUE) {
+			if (rc == Acquire::INCOMPATIBLE && req->ts < owner_ts.load(std::memory_order_relaxed) && parked().park(this, pkt)) {
+				// the holder may have let go before the request was parked.
+				grant_parked(comm);
+				return;
+			}
+		}
+        if (rc != Acquire::SUCCESS) {
             auto res = req->convert<msg::TupleGetRes>();
             res->mode = AccessMode::INVALID;
             comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
             return;
         }
 
-        ++owner_cnt;
-        lock_type = req->mode;
+        grant(pkt, prev);
+        comm.send(pkt->as<msg::Header>()->sender, pkt, comm.mh_tid); // always called from msg-handler
+    }
 
-        auto res = req->convert<msg::TupleGetRes>();
-        auto size = msg::TupleGetRes::size(sizeof(tuple));
-        pkt->resize(size);
-		res->last_acq_pack = last_acq.get_packed();
+	// turns the TupleGetReq in pkt into the reply that hands out the row.
+	void grant(Communicator::Pkt_t* pkt, latch_t prev) {
+        auto res = pkt->as<msg::TupleGetReq>()->convert<msg::TupleGetRes>();
+        pkt->resize(msg::TupleGetRes::size(sizeof(tuple)));
+		res->last_acq_pack = last_acq(prev).get_packed();
+		res->version = version(prev);
         std::memcpy(res->tuple, &tuple, sizeof(tuple));
+	}
+
+	static ParkedLocks& parked() {
+		static ParkedLocks queues;
+		return queues;
+	}
+
+	// from whichever thread released the row, see ParkedLocks.
+	void grant_parked(Communicator& comm) {
+		parked().wake(this, comm, [&](Communicator::Pkt_t* pkt) {
+			auto req = pkt->as<msg::TupleGetReq>();
+			latch_t prev;
+			Acquire rc = try_acquire(req->mode, TxnId(req->me_pack), req->ts, prev);
+			if (rc == Acquire::INCOMPATIBLE) {
+				return false;
+			}
+			if (rc == Acquire::SUCCESS) {
+				grant(pkt, prev);
+			} else {
+				ParkedLocks::refuse(pkt);
+			}
+			return true;
+		});
+	}
+
+	/*	Seqlock-style read: copy the tuple without taking the latch, and succeed only if no
+		writer held or released the row in between. */
+	bool optimistic_read(Tuple_t& out, uint32_t& out_version) {
+		latch_t before = latch.load(std::memory_order_acquire);
+		if (lock_type(before) == AccessMode::WRITE) {
+			return false;
+		}
+		std::memcpy(&out, &tuple, sizeof(tuple));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		latch_t after = latch.load(std::memory_order_relaxed);
+		if (lock_type(after) == AccessMode::WRITE || version(after) != version(before)) {
+			return false;
+		}
+		out_version = version(before);
+		return true;
+	}
 
+	// read set validation at commit, the row must be unchanged and not being written.
+	bool validate(uint32_t read_version) {
+		latch_t word = latch.load(std::memory_order_acquire);
+		return lock_type(word) != AccessMode::WRITE && version(word) == read_version;
+	}
+
+    void remote_read(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleGetReq* req) {
+		auto res = req->convert<msg::TupleGetRes>();
+		uint32_t read_version;
+		if (!optimistic_read(*reinterpret_cast<Tuple_t*>(res->tuple), read_version)) {
+            res->mode = AccessMode::INVALID;
+            comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+            return;
+		}
+        pkt->resize(msg::TupleGetRes::size(sizeof(tuple)));
+		res->version = read_version;
+        comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+    }
+
+	// by the holder of the write latch, before it changes the tuple.
+	void preserve_snapshot() {
+		if constexpr (USE_SNAPSHOT_READS) {
+			uint32_t epoch = snapshot_epoch.load(std::memory_order_relaxed);
+			if (snap.epoch.load(std::memory_order_relaxed) != epoch) {
+				std::memcpy(&snap.tuple, &tuple, sizeof(tuple));
+				/*	seqlock writer: the release store publishes the copy, and the release fence keeps the
+					caller's later stores to tuple behind the new epoch, so a snapshot_read that saw any
+					of them (acquire fence) sees the new epoch on its second look. */
+				snap.epoch.store(epoch, std::memory_order_release);
+				std::atomic_thread_fence(std::memory_order_release);
+			}
+		}
+	}
+
+	/*	The tuple as of the start of epoch, without latching. Fails if a later epoch already
+		replaced the copy. A writer that preserves the row while the tuple is being copied is
+		caught by the second look at snap.epoch. */
+	bool snapshot_read(Tuple_t& out, uint32_t epoch) {
+		if constexpr (!USE_SNAPSHOT_READS) {
+			return false;
+		} else {
+			uint32_t e = snap.epoch.load(std::memory_order_acquire);
+			if (e < epoch) {
+				std::memcpy(&out, &tuple, sizeof(tuple));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				e = snap.epoch.load(std::memory_order_relaxed);
+				if (e < epoch) {
+					return true;
+				}
+			}
+			if (e != epoch) {
+				return false;
+			}
+			std::memcpy(&out, &snap.tuple, sizeof(tuple));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return snap.epoch.load(std::memory_order_relaxed) == epoch;
+		}
+	}
+
+    void remote_snapshot_read(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleGetReq* req) {
+		auto res = req->convert<msg::TupleGetRes>();
+		uint32_t epoch = req->epoch;
+		// only this node's current epoch is kept.
+		if (epoch != snapshot_epoch.load(std::memory_order_acquire) ||
+				!snapshot_read(*reinterpret_cast<Tuple_t*>(res->tuple), epoch)) {
+            res->mode = AccessMode::INVALID;
+            comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+            return;
+		}
+        pkt->resize(msg::TupleGetRes::size(sizeof(tuple)));
+        comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+    }
+
+    void remote_validate(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleValidateReq* req) {
+		bool valid = validate(req->version);
+		auto res = req->convert<msg::TupleValidateRes>();
+		if (!valid) {
+			res->mode = AccessMode::INVALID;
+		}
         comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
     }
 
     void remote_unlock(msg::TuplePutReq* req, Communicator& comm) {
         if (req->mode == AccessMode::WRITE) {
+            // the epoch may have moved on since the lock was granted.
+            preserve_snapshot();
             std::memcpy(&tuple, req->tuple, sizeof(tuple));
         }
         auto rc = local_unlock(req->mode, req->ts, comm, TxnId(req->last_acq_pack));
         (void)rc;
     }
 
-    ErrorCode local_unlock(const AccessMode mode, const timestamp_t, Communicator&, TxnId id) {
-        const std::lock_guard<lock_t> lock(mutex);
-        // lock_t::scoped_lock lock;
-        // lock.acquire(mutex);
+    // a release that was piggybacked on another message, see msg::ReleaseTrailer.
+    void remote_unlock(const msg::TupleRelease& rel, Communicator& comm) {
+        if (rel.mode == AccessMode::WRITE) {
+            preserve_snapshot();
+            std::memcpy(&tuple, rel.tuple, sizeof(tuple));
+        }
+        auto rc = local_unlock(rel.mode, 0, comm, TxnId(rel.last_acq_pack));
+        (void)rc;
+    }
 
+    ErrorCode local_unlock(const AccessMode mode, const timestamp_t, Communicator& comm, TxnId id) {
 		// fprintf(stderr, "id: (%u,%u,%u)\n", id.field.valid, id.field.node_id, id.field.mini_batch_id);
-		last_acq = id;
-        if (lock_type != mode) [[unlikely]] {
-            std::cout << "lock_type=" << static_cast<uint8_t>(lock_type) << " mode=" << static_cast<uint8_t>(mode) << '\n';
+		timestamp_t held_ts = owner_ts.load(std::memory_order_relaxed);
+		latch_t word = latch.load(std::memory_order_relaxed);
+		latch_t next;
+		do {
+			if (lock_type(word) != mode) [[unlikely]] {
+				next = pack(lock_type(word), owner_cnt(word), version(word), id);
+			} else {
+				// owner_cnt == 0 -> no active locks
+				uint32_t cnt = owner_cnt(word) - 1;
+				uint32_t next_version = version(word) + (mode == AccessMode::WRITE);
+				next = pack(cnt > 0 ? mode : AccessMode::INVALID, cnt, next_version, id);
+			}
+		} while (!latch.compare_exchange_weak(word, next,
+				std::memory_order_release, std::memory_order_relaxed));
+
+        if (lock_type(word) != mode) [[unlikely]] {
+            std::cout << "lock_type=" << static_cast<uint8_t>(lock_type(word)) << " mode=" << static_cast<uint8_t>(mode) << '\n';
             return ErrorCode::INVALID_ACCESS_MODE;
         }
-
-        if (--owner_cnt > 0) {
-            return ErrorCode::SUCCESS;
+        // the last owner left, unless a new one already put in its own ts.
+        if (owner_cnt(next) == 0) {
+            owner_ts.compare_exchange_strong(held_ts, cc::NO_TS, std::memory_order_relaxed);
+        }
+        if constexpr (USE_REMOTE_LOCK_QUEUE) {
+            if (lock_type(next) != AccessMode::WRITE) {
+                grant_parked(comm);
+            }
         }
-        // owner_cnt == 0 -> no active locks
-
-        lock_type = AccessMode::INVALID;
         return ErrorCode::SUCCESS;
     }
 
 
-    bool is_compatible(AccessMode mode) {
-        if (lock_type == AccessMode::INVALID) {
+    static bool is_compatible(AccessMode held, AccessMode mode) {
+        if (held == AccessMode::INVALID) {
             return true;
         }
-        if (lock_type == AccessMode::WRITE || mode == AccessMode::WRITE) {
+        if (held == AccessMode::WRITE || mode == AccessMode::WRITE) {
             return false;
         }
         return true; // shared
     };
 
     bool check() {
-        return (lock_type == AccessMode::INVALID);
+        return (lock_type(latch.load(std::memory_order_relaxed)) == AccessMode::INVALID);
     }
 };
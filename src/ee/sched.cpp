@@ -37,7 +37,7 @@ scheduler_t::scheduler_t(TxnExecutor* exec) : exec(exec) {
 			}
 		}
 	}
-	mb_queues = new std::queue<txn_pos_t>[n_queues];
+	mb_queues = new txn_queue_t[n_queues];
 }
 
 void scheduler_t::sched_batch(std::vector<Txn>& txns, size_t start, size_t end) {
@@ -94,6 +94,33 @@ void scheduler_t::sched_batch(std::vector<Txn>& txns, size_t start, size_t end)
     */
 }
 
+/*	the order txn_executor will run the scheduled batch in: n_visits mini-batches that take up
+	to mini_batch_tgt txns from queue (mb-1) % n_queues each, then one drain mini-batch over all the
+	queues. Only accelerated txns run in the mini-batches, the rest go straight to the leftovers. */
+std::vector<LockAheadTable::entry_t> scheduler_t::lock_ahead_sequence(size_t first_mb, size_t mini_batch_tgt, size_t n_visits) {
+	std::vector<LockAheadTable::entry_t> seq;
+	std::vector<size_t> taken(n_queues, 0);
+
+	auto add = [&](uint32_t mb, txn_pos_t e) {
+		Txn& txn = entry_to_txn(exec, e);
+		if (txn.do_accel) {
+			seq.push_back({mb, &txn});
+		}
+	};
+	for (size_t v = 0; v<n_visits; ++v) {
+		size_t qn = (first_mb-1+v) % n_queues;
+		for (size_t n = 0; n<mini_batch_tgt && taken[qn]<mb_queues[qn].size(); ++n) {
+			add(v, mb_queues[qn][taken[qn]++]);
+		}
+	}
+	for (size_t qn = 0; qn<n_queues; ++qn) {
+		while (taken[qn]<mb_queues[qn].size()) {
+			add(n_visits, mb_queues[qn][taken[qn]++]);
+		}
+	}
+	return seq;
+}
+
 Txn& entry_to_txn(TxnExecutor* exec, txn_pos_t entry) {
     std::vector<Txn>& txns = (*(exec->my_txns));
     assert(entry < txns.size());
@@ -49,12 +49,12 @@ void Database::setup_sched_sock() {
 	this->sched_sockfd = server_sockfd;
 }
 
-void Database::update_alloc(uint32_t batch_num) {
+void Database::update_alloc(uint32_t batch_num, uint64_t start_delay_ns, uint64_t duration_ns) {
     static Config& conf = Config::instance();
 
     struct alloc_req_t req;
-    req.start_delay_ns = COLD_BATCH_DUR_EST_NS;
-    req.duration_ns = HOT_BATCH_DUR_EST_NS;
+    req.start_delay_ns = start_delay_ns;
+    req.duration_ns = duration_ns;
     // if no block, this is NO_BLOCK, which is what the scheduler expects.
     req.blk_to_free = conf.decl_layout->block_num;
     // scheduler expects 1-indexed.
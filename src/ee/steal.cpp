@@ -0,0 +1,99 @@
+#include "ee/steal.hpp"
+
+#include <bit>
+#include <mutex>
+#include <stdexcept>
+
+StealDeque::StealDeque(size_t capacity)
+	: ring(std::make_unique<std::atomic<uint32_t>[]>(std::bit_ceil(capacity))), mask(std::bit_ceil(capacity)-1), top(0), bottom(0) {}
+
+// the fences follow Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+void StealDeque::push(uint32_t pos) {
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t > static_cast<int64_t>(mask)) [[unlikely]] {
+		throw std::runtime_error("steal deque full");
+	}
+	ring[b & mask].store(pos, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b+1, std::memory_order_relaxed);
+}
+
+bool StealDeque::take(uint32_t& pos) {
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	if (t > b) {
+		bottom.store(b+1, std::memory_order_relaxed);
+		return false;
+	}
+	pos = ring[b & mask].load(std::memory_order_relaxed);
+	if (t == b) {
+		// the last one, a thief may be after it too.
+		bool won = top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b+1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+StealDeque::Steal StealDeque::steal(uint32_t& pos) {
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b) {
+		return Steal::EMPTY;
+	}
+	pos = ring[t & mask].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return Steal::RETRY;
+	}
+	return Steal::SUCCESS;
+}
+
+
+WorkStealing::WorkStealing(size_t n_workers) {
+	for (size_t i = 0; i < n_workers; ++i) {
+		workers.emplace_back(std::make_unique<worker_t>(USE_ADAPTIVE_MINI_BATCH ? BATCH_SIZE_TGT/MIN_MINI_BATCHES : MINI_BATCH_SIZE_TGT));
+	}
+}
+
+/*	Visits the other workers round-robin, starting next to the thief so that thieves spread out.
+	A lost race means the victim may have more, so it only gives up after a full round without. */
+bool WorkStealing::steal(uint32_t thief, uint32_t& owner, uint32_t& pos) {
+	const size_t n = workers.size();
+	while (true) {
+		bool retry = false;
+		for (size_t k = 1; k < n; ++k) {
+			uint32_t victim = (thief + k) % n;
+			switch (workers[victim]->deque.steal(pos)) {
+				case StealDeque::Steal::SUCCESS:
+					owner = victim;
+					return true;
+				case StealDeque::Steal::RETRY:
+					retry = true;
+					break;
+				case StealDeque::Steal::EMPTY:
+					break;
+			}
+		}
+		if (!retry) {
+			return false;
+		}
+		__builtin_ia32_pause();
+	}
+}
+
+void WorkStealing::bounce(uint32_t owner, uint32_t pos) {
+	worker_t& w = *workers[owner];
+	std::lock_guard guard(w.lock);
+	w.bounced.push_back(pos);
+}
+
+void WorkStealing::take_bounced(uint32_t owner, std::vector<uint32_t>& out) {
+	worker_t& w = *workers[owner];
+	std::lock_guard guard(w.lock);
+	out.swap(w.bounced);
+	w.bounced.clear();
+}
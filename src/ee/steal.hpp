@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ee/defs.hpp"
+#include "utils/spinlock.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// lock-ahead plans every worker's own txns in order, a stolen txn would miss its slots.
+static_assert(!(USE_WORK_STEALING && USE_LOCK_AHEAD), "work stealing and lock-ahead do not mix");
+
+/*	Chase-Lev deque of the txns (positions into the owner's txns) a worker has left in the
+	current mini-batch. The owner takes from the bottom, the other workers steal from the top.
+	It is only filled at the start of a mini-batch, while nobody steals, so the ring never grows. */
+struct StealDeque {
+	enum class Steal { SUCCESS, EMPTY, RETRY };
+
+	std::unique_ptr<std::atomic<uint32_t>[]> ring;
+	size_t mask;
+	alignas(64) std::atomic<int64_t> top;
+	alignas(64) std::atomic<int64_t> bottom;
+
+	StealDeque(size_t capacity);
+
+	void push(uint32_t pos);
+	bool take(uint32_t& pos);
+	Steal steal(uint32_t& pos);
+};
+
+/*	Per node, the deques of all workers. A stolen txn runs under the mini-batch id of the thief,
+	which is the one of its owner since the workers meet after every mini-batch. Only the owner
+	may requeue a txn though, so a stolen txn that aborts or is not accelerated is bounced back
+	and picked up by its owner after the barrier. */
+struct WorkStealing {
+	struct worker_t {
+		StealDeque deque;
+		SpinLock lock;
+		std::vector<uint32_t> bounced;
+
+		worker_t(size_t capacity) : deque(capacity) {}
+	};
+
+	std::vector<std::unique_ptr<worker_t>> workers;
+
+	WorkStealing(size_t n_workers);
+
+	// a txn of another worker, false once every other deque is empty.
+	bool steal(uint32_t thief, uint32_t& owner, uint32_t& pos);
+	void bounce(uint32_t owner, uint32_t pos);
+	void take_bounced(uint32_t owner, std::vector<uint32_t>& out);
+};
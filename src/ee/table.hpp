@@ -31,7 +31,12 @@ struct Table {
     // returns bytes written by tuple
     virtual size_t tuple_size() = 0;
     virtual void remote_get(Communicator::Pkt_t* pkt, msg::TupleGetReq* req) = 0;
+    virtual void remote_get(Communicator::Pkt_t* pkt, msg::TupleMultiGetReq* req) = 0;
     virtual void remote_put(msg::TuplePutReq* req) = 0;
+    virtual void remote_put(const msg::TupleRelease& rel) = 0;
+    virtual void remote_validate(Communicator::Pkt_t* pkt, msg::TupleValidateReq* req) = 0;
+    virtual void remote_execute(Communicator::Pkt_t* pkt, msg::TupleFragmentReq* req) = 0;
+    virtual void remote_end(msg::TupleFragmentEndReq* req) = 0;
 
     virtual void print(){};
 };
@@ -98,6 +103,9 @@ struct KV {
 struct StructTable final : public Table {
     using Row_t = Row<KV>;
     using Future_t = TupleFuture<KV>;
+    static_assert(sizeof(Row_t) <= ROW_CACHE_LINE_BYTES, "Row<KV> spills over a cache line");
+    static_assert(!USE_MULTI_GET || msg::TupleMultiGetRes::size(MULTI_GET_MAX_KEYS, sizeof(KV)) <= MSG_SIZE);
+    static_assert(sizeof(KV) <= msg::RELEASE_TUPLE_BYTES);
 
     std::atomic<uint64_t> size{0};
     const size_t max_size;
@@ -172,6 +180,61 @@ struct StructTable final : public Table {
         return row.local_lock(mode, ts, future);
     }
 
+    // pulls a row that will be locked soon into the cache, remote keys are skipped.
+    void prefetch(const db_key_t index) {
+        if (!part_info.location(index).is_local) {
+            return;
+        }
+        auto local_index = part_info.translate(index);
+        if (local_index < size) {
+            __builtin_prefetch(&data[local_index], 1, 3);
+        }
+    }
+
+    // for the local-only fast path, hands out the row itself instead of filling a future.
+    Row_t* latch(const db_key_t index, const AccessMode mode, const timestamp_t ts, TxnId id, TxnId& last_acq) {
+        auto local_index = part_info.translate(index);
+        if (local_index >= size) {
+            return nullptr;
+        }
+        auto& row = data[local_index];
+        Row_t::latch_t prev;
+        if (row.latch_local(mode, ts, id, prev) != ErrorCode::SUCCESS) {
+            return nullptr;
+        }
+        last_acq = Row_t::last_acq(prev);
+        return &row;
+    }
+
+    // no latch taken, see Row::optimistic_read.
+    ErrorCode optimistic_get(const db_key_t index, KV& out, uint32_t& version) {
+        auto local_index = part_info.translate(index);
+        if (local_index >= size) {
+            return ErrorCode::INVALID_ROW_ID;
+        }
+        if (!data[local_index].optimistic_read(out, version)) {
+            return ErrorCode::READ_LOCK_FAILED;
+        }
+        return ErrorCode::SUCCESS;
+    }
+
+    // no latch taken, see Row::snapshot_read.
+    ErrorCode snapshot_get(const db_key_t index, KV& out, uint32_t epoch) {
+        auto local_index = part_info.translate(index);
+        if (local_index >= size) {
+            return ErrorCode::INVALID_ROW_ID;
+        }
+        if (!data[local_index].snapshot_read(out, epoch)) {
+            return ErrorCode::READ_LOCK_FAILED;
+        }
+        return ErrorCode::SUCCESS;
+    }
+
+    bool validate(const db_key_t index, uint32_t version) {
+        auto local_index = part_info.translate(index);
+        return data[local_index].validate(version);
+    }
+
     ErrorCode put(db_key_t index, const AccessMode mode, const timestamp_t ts, TxnId id) {
         auto local_index = part_info.translate(index);
         if (local_index >= size) {
@@ -202,9 +265,73 @@ struct StructTable final : public Table {
         auto local_index = part_info.translate(req->rid);
         auto& row = data[local_index];
 		// fprintf(stderr, "Trying to lock key %lu\n", req->rid);
+        if (req->flags & msg::TupleFlags::OPTIMISTIC) {
+            row.remote_read(comm, pkt, req);
+            return;
+        }
+        if constexpr (USE_SNAPSHOT_READS) {
+            if (req->flags & msg::TupleFlags::SNAPSHOT) {
+                row.remote_snapshot_read(comm, pkt, req);
+                return;
+            }
+        }
         row.remote_lock(comm, pkt, req);
     }
 
+    virtual void remote_get(Communicator::Pkt_t* pkt, msg::TupleMultiGetReq* req) override {
+        auto res = req->convert<msg::TupleMultiGetRes>();
+        TxnId me(res->me_pack);
+        for (uint8_t i = 0; i < res->n; ++i) {
+            auto& entry = res->entries[i];
+            auto& row = data[part_info.translate(entry.rid)];
+            Row_t::latch_t prev;
+            if (!row.remote_acquire(entry.mode, me, res->ts, prev)) {
+                // all-or-nothing, hand back what was granted so far.
+                for (uint8_t j = 0; j < i; ++j) {
+                    auto& granted = res->entries[j];
+                    auto rc = data[part_info.translate(granted.rid)].local_unlock(granted.mode, res->ts, comm, TxnId(granted.last_acq_pack));
+                    (void)rc;
+                }
+                res->failed = i;
+                break;
+            }
+            entry.last_acq_pack = Row_t::last_acq(prev).get_packed();
+            entry.version = Row_t::version(prev);
+            std::memcpy(res->tuple(i, sizeof(KV)), &row.tuple, sizeof(KV));
+        }
+        pkt->resize(msg::TupleMultiGetRes::size(res->n, sizeof(KV)));
+        comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+    }
+
+    virtual void remote_execute(Communicator::Pkt_t* pkt, msg::TupleFragmentReq* req) override {
+        auto res = req->convert<msg::TupleFragmentRes>();
+        TxnId me(res->me_pack);
+        for (uint8_t i = 0; i < res->n; ++i) {
+            auto& entry = res->entries[i];
+            auto& row = data[part_info.translate(entry.rid)];
+            Row_t::latch_t prev;
+            if (!row.remote_acquire(entry.mode, me, res->ts, prev)) {
+                // vote abort, the keys before i are restored and released with their old last_acq.
+                release_fragment(res, i, true);
+                res->failed = i;
+                break;
+            }
+            entry.last_acq_pack = Row_t::last_acq(prev).get_packed();
+            entry.version = Row_t::version(prev);
+            uint32_t value = row.tuple.value;
+            if (entry.mode == AccessMode::WRITE) {
+                row.tuple.value = res->values[i];
+            }
+            res->values[i] = value;
+        }
+        pkt->resize(sizeof(msg::TupleFragmentRes));
+        comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+    }
+
+    virtual void remote_end(msg::TupleFragmentEndReq* req) override {
+        release_fragment(req, req->n, req->flags & msg::TupleFlags::ABORTED);
+    }
+
     virtual void remote_put(msg::TuplePutReq* req) override {
         auto local_index = part_info.translate(req->rid);
 
@@ -218,6 +345,30 @@ struct StructTable final : public Table {
         row.remote_unlock(req, comm);
     }
 
+    virtual void remote_put(const msg::TupleRelease& rel) override {
+        auto& row = data[part_info.translate(rel.rid)];
+        row.remote_unlock(rel, comm);
+    }
+
+    virtual void remote_validate(Communicator::Pkt_t* pkt, msg::TupleValidateReq* req) override {
+        auto local_index = part_info.translate(req->rid);
+        auto& row = data[local_index];
+        row.remote_validate(comm, pkt, req);
+    }
+
+    // on abort puts back the values overwritten by the first n keys of a fragment, then releases them.
+    void release_fragment(msg::TupleFragmentMsgHeader* frag, uint8_t n, bool aborted) {
+        for (uint8_t i = 0; i < n; ++i) {
+            auto& entry = frag->entries[i];
+            auto& row = data[part_info.translate(entry.rid)];
+            if (aborted && entry.mode == AccessMode::WRITE) {
+                row.tuple.value = frag->values[i];
+            }
+            auto rc = row.local_unlock(entry.mode, frag->ts, comm, TxnId(entry.last_acq_pack));
+            (void)rc;
+        }
+    }
+
     virtual size_t tuple_size() override {
         return sizeof(KV);
     }
@@ -1,50 +1,185 @@
 #include "undolog.hpp"
 
 #include "comm/msg_handler.hpp"
+#include "main/config.hpp"
 
 #include <stdlib.h>
 #include <x86intrin.h>
 
 uint64_t log_wait_time[32] = {};
 
-static uint64_t micros_diff(struct timespec* t_start, struct timespec* t_end) {
-    uint64_t s_micros = ((((uint64_t) t_start->tv_sec) * 1000000000) + t_start->tv_nsec) / 1000;
-    uint64_t e_micros = ((((uint64_t) t_end->tv_sec) * 1000000000) + t_end->tv_nsec) / 1000;
-    return e_micros-s_micros;
+
+/*	Sends the releases but does not wait for their TuplePutRes, the executor does that
+	(TxnExecutor::wait_put_responses) so a waiting txn can yield to others. */
+void Undolog::clear(const timestamp_t ts, bool aborted) {
+    bool remote = false;
+    for (size_t i = 0; i < n; ++i) {
+        switch (entries[i].kind) {
+            case Kind::READ:
+            case Kind::WRITE:
+                release_local(entries[i], ts);
+                break;
+            default:
+                remote = true;
+        }
+    }
+
+    // a node's releases leave back to back, n is at most N_OPS so the quadratic walk is cheap.
+    if (remote) {
+        bool sent[CAPACITY] = {};
+        for (size_t i = 0; i < n; ++i) {
+            if (sent[i] || entries[i].kind < Kind::REMOTE_READ) {
+                continue;
+            }
+            uint32_t node = entries[i].target;
+            for (size_t j = i; j < n; ++j) {
+                if (!sent[j] && entries[j].kind >= Kind::REMOTE_READ && entries[j].target == node) {
+                    release_remote(entries[j], aborted);
+                    sent[j] = true;
+                }
+            }
+        }
+
+        // the multi-get replies are only needed until every key they granted is released.
+        for (size_t i = 0; i < n; ++i) {
+            if (entries[i].kind == Kind::REMOTE_MULTI && entries[i].multi_i == 0) {
+                entries[i].multi->get_pkt()->free();
+            }
+        }
+    }
+    n = 0;
 }
 
+void Undolog::release_local(const entry_t& entry, const timestamp_t ts) {
+    if (!entry.future->tuple) {
+        throw std::runtime_error("tuple not set in undolog clear");
+    }
+    AccessMode mode = entry.kind == Kind::WRITE ? AccessMode::WRITE : AccessMode::READ;
+    if (!entry.table->put(entry.index, mode, ts, entry.future->last_acq)) {
+        throw error::UndoException();
+    }
+}
+
+void Undolog::release_remote(const entry_t& entry, bool aborted) {
+    switch (entry.kind) {
+        case Kind::REMOTE_READ:
+        case Kind::REMOTE_WRITE: {
+            auto tuple = entry.future->get();
+            if (!tuple) {
+                return; // TupleGetReq Failed, but entry is in Log, pkt is already freed earlier
+            }
+
+            auto pkt = entry.future->get_pkt();
+            if constexpr (USE_PIGGYBACK_RELEASES) {
+                auto res = pkt->as<msg::TupleGetRes>();
+                AccessMode mode = entry.kind == Kind::REMOTE_WRITE ? AccessMode::WRITE : AccessMode::READ;
+                releases->add(entry.target, res->tid, res->rid, mode, entry.future->last_acq, tuple);
+                pkt->free();
+                return;
+            }
+
+            // the reply pkt is turned into the release, it is large enough for the tuple.
+            auto req = pkt->as<msg::TupleGetRes>()->convert<msg::TuplePutReq>();
+            req->sender = msg::node_t{comm->node_id, tid};
+            req->last_acq_pack = entry.future->last_acq.get_packed();
+            if (entry.kind == Kind::REMOTE_WRITE) {
+                std::memcpy(req->tuple, tuple, sizeof(KV));
+            } else {
+                pkt->resize(msg::TuplePutReq::size(0));
+            }
 
-void Undolog::clear(const timestamp_t ts) {
-    int rc;
-    struct timespec ts_begin;
-    rc = clock_gettime(CLOCK_REALTIME, &ts_begin);
-    assert(rc == 0);
+            comm->handler->putresponses.add(tid);
+            comm->send(entry.target, pkt, tid);
+            break;
+        }
+        case Kind::REMOTE_MULTI: {
+            auto res = entry.multi->get_pkt()->as<msg::TupleMultiGetRes>();
+            auto& granted = res->entries[entry.multi_i];
+            if constexpr (USE_PIGGYBACK_RELEASES) {
+                releases->add(entry.target, res->tid, granted.rid, granted.mode, entry.future->last_acq, entry.future->get());
+                break;
+            }
 
-    for (auto& action : actions) {
-        action->clear(comm, tid, ts);
+            auto pkt = comm->make_pkt();
+            auto req = pkt->ctor<msg::TuplePutReq>(res->ts, res->tid, granted.rid, granted.mode, entry.future->last_acq);
+            req->sender = msg::node_t{comm->node_id, tid};
+            if (granted.mode == AccessMode::WRITE) {
+                std::memcpy(req->tuple, entry.future->get(), sizeof(KV));
+                pkt->resize(msg::TuplePutReq::size(sizeof(KV)));
+            } else {
+                pkt->resize(msg::TuplePutReq::size(0));
+            }
+
+            comm->handler->putresponses.add(tid);
+            comm->send(entry.target, pkt, tid);
+            break;
+        }
+        case Kind::REMOTE_FRAGMENT: {
+            // the whole fragment ends with one message, the reply turned around at its first key.
+            if (entry.multi_i != 0) {
+                break;
+            }
+            auto pkt = entry.multi->get_pkt();
+            auto req = pkt->as<msg::TupleFragmentRes>()->convert<msg::TupleFragmentEndReq>();
+            const entry_t* keys = &entry;
+            for (uint8_t k = 0; k < req->n; ++k) {
+                req->entries[k].last_acq_pack = keys[k].future->last_acq.get_packed();
+            }
+            req->flags = aborted ? msg::TupleFlags::ABORTED : 0;
+            req->sender = msg::node_t{comm->node_id, tid};
+
+            comm->handler->putresponses.add(tid);
+            comm->send(entry.target, pkt, tid);
+            break;
+        }
+        default:
+            throw error::InvalidAccessMode();
     }
-    pool.clear();
-    actions.clear();
-    comm->handler->putresponses.wait(tid); // wait for all remote responses
+}
 
-    struct timespec ts_end;
-    rc = clock_gettime(CLOCK_REALTIME, &ts_end);
-    assert(rc == 0);
 
-    if (WorkerContext::context != nullptr) {
-        log_wait_time[WorkerContext::get().tid] += micros_diff(&ts_begin, &ts_end);
+PendingReleases::PendingReleases(Communicator* comm)
+    : nodes(Config::instance().num_nodes), comm(comm), tid(WorkerContext::get().tid) {}
+
+void PendingReleases::add(msg::node_t target, p4db::table_t table, db_key_t rid, AccessMode mode, TxnId last_acq, const KV* tuple) {
+    if (nodes[target].n == PIGGYBACK_MAX_RELEASES) {
+        flush(target);
+    }
+    auto& rel = nodes[target].releases[nodes[target].n++];
+    rel.rid = rid;
+    rel.tid = table;
+    rel.mode = mode;
+    rel.last_acq_pack = last_acq.get_packed();
+    if (mode == AccessMode::WRITE) {
+        std::memcpy(rel.tuple, tuple, sizeof(KV));
     }
 }
 
-void Undolog::clear_last_n(const timestamp_t ts, const size_t n) {
-    if (actions.size() < n) {
-        throw std::runtime_error("tried clearing more in undolog than that is there...");
+void PendingReleases::attach(msg::node_t target, msg::Header* msg, uint8_t& flags) {
+    auto& pending = nodes[target];
+    if (pending.n == 0) {
+        return;
     }
-    for (size_t i = 0; i < n; i++) {
-        auto action = actions.back();
-        action->clear(comm, tid, ts);
-        actions.pop_back();
+    std::memcpy(msg::release_trailer(msg), &pending, sizeof(pending));
+    flags |= msg::TupleFlags::RELEASES;
+    pending.n = 0;
+}
+
+void PendingReleases::flush(uint32_t node) {
+    if (nodes[node].n == 0) {
+        return;
+    }
+    auto pkt = comm->make_pkt();
+    auto req = pkt->ctor<msg::TupleReleaseReq>();
+    req->sender = msg::node_t{comm->node_id, tid};
+    attach(node, req, req->flags);
+
+    comm->handler->putresponses.add(tid);
+    comm->send(node, pkt, tid);
+}
+
+void PendingReleases::flush_all() {
+    for (uint32_t node = 0; node < nodes.size(); ++node) {
+        flush(node);
     }
-    // putresponses += 1 on remote.clear()
-    comm->handler->putresponses.wait(tid); // wait for all remote responses
 }
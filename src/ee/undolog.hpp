@@ -5,151 +5,117 @@
 #include "ee/future.hpp"
 #include "ee/table.hpp"
 #include "ee/row.hpp"
-#include "utils/mempools.hpp"
 #include "utils/context.hpp"
 
-struct Action {
-    virtual ~Action() = default;
-    virtual void clear(Communicator* comm, uint32_t tid, const timestamp_t ts) = 0;
-};
-
-template <typename Table_t, typename Future_t>
-struct Write final : public Action {
-    Table_t* table;
-    db_key_t index;
-    Future_t* future;
-
-    Write(Table_t* table, db_key_t index, Future_t* future)
-        : table(table), index(index), future(future) {}
-
-    void clear(Communicator*, uint32_t, const timestamp_t ts) override {
-        if (!future->tuple) {
-            throw std::runtime_error("tuple not set in undolog clear");
-        }
-		// fprintf(stderr, "Executing put with id: %u\n", future->last_acq.get_packed());
-        if (!table->put(index, AccessMode::WRITE, ts, future->last_acq)) {
-            throw error::UndoException();
-        }
-    }
-};
-
-template <typename Table_t, typename Future_t>
-struct Read final : public Action {
-    Table_t* table;
-    db_key_t index;
-    Future_t* future;
-
-    Read(Table_t* table, db_key_t index, Future_t* future)
-        : table(table), index(index), future(future) {}
-
-    void clear(Communicator*, uint32_t, const timestamp_t ts) override {
-        if (!future->tuple) {
-            throw std::runtime_error("tuple not set in undolog clear");
-        }
-		// fprintf(stderr, "Executing put with id: %u\n", future->last_acq.get_packed());
-        if (!table->put(index, AccessMode::READ, ts, future->last_acq)) {
-            throw error::UndoException();
-        }
-    }
-};
-
-template <typename Tuple_t, AccessMode mode>
-struct Remote final : public Action {
-    TupleFuture<Tuple_t>* future;
-    msg::node_t target;
-
-    Remote(TupleFuture<Tuple_t>* future, msg::node_t target)
-        : future(future), target(target) {}
+#include <array>
+#include <cstring>
+#include <vector>
 
-    void clear(Communicator* comm, uint32_t tid, const timestamp_t) override {
-        auto tuple = future->get();
-        if (!tuple) {
-            return; // TupleGetReq Failed, but action is in Log, pkt is already freed earlier
-        }
+/*	Per worker, the remote releases that wait for the next get to the same node (see
+	msg::ReleaseTrailer). A full trailer and flush_all() go out as a TupleReleaseReq, whose
+	TuplePutRes is counted in putresponses like a regular release. */
+struct PendingReleases {
+    std::vector<msg::ReleaseTrailer> nodes;
+    Communicator* comm;
+    uint32_t tid;
 
-        auto pkt = future->get_pkt();
-        auto res = pkt->template as<msg::TupleGetRes>();
+    PendingReleases(Communicator* comm);
 
-        auto req = res->template convert<msg::TuplePutReq>();
-        if (req->tid > 4) {
-            std::cout << "tid=" << req->tid << " mode=" << static_cast<int>(res->mode) << " msg_id=" << res->msg_id << " tid=" << res->tid << '\n';
-            throw std::runtime_error("sth wrong");
-        }
-        req->sender = msg::node_t{comm->node_id, tid};
-		req->last_acq_pack = future->last_acq.get_packed();
-
-        switch (mode) {
-            case AccessMode::READ: {
-                auto size = msg::TuplePutReq::size(0);
-                pkt->resize(size);
-                break;
-            }
-            case AccessMode::WRITE: {
-                // size is already enough because we received the tuple of same size
-				std::memcpy(req->tuple, tuple, sizeof(Tuple_t));
-                break;
-            }
-            default:
-                throw error::InvalidAccessMode();
-        }
-
-        comm->handler->putresponses.add(tid);
-        comm->send(target, pkt, tid);
-    }
+    void add(msg::node_t target, p4db::table_t table, db_key_t rid, AccessMode mode, TxnId last_acq, const KV* tuple);
+    // moves whatever is pending for target into the trailer of msg, which goes there next.
+    void attach(msg::node_t target, msg::Header* msg, uint8_t& flags);
+    void flush(uint32_t node);
+    void flush_all();
 };
 
-
+/*	What a txn holds, as a flat array of tagged entries instead of virtual Actions out of a
+	pool. A txn locks every op (or copy of it) at most once, so CAPACITY entries always suffice. clear() switches
+	on the tag, releases the local keys first and then sends the remote releases node by node. */
 struct Undolog {
-    StackPool<65536> pool;
-    std::vector<Action*> actions; // maybe embed into struct
+    using Table_t = StructTable;
+    using Future_t = TupleFuture<KV>;
+
+    // a write to a replicated key locks a copy per node.
+    static constexpr size_t CAPACITY = USE_READ_REPLICAS ? N_OPS * READ_REPLICA_MAX_NODES : N_OPS;
+
+    enum class Kind : uint8_t {
+        READ,
+        WRITE,
+        REMOTE_READ,
+        REMOTE_WRITE,
+        REMOTE_MULTI, // one key of a TupleMultiGetRes
+        REMOTE_FRAGMENT, // one key of a TupleFragmentRes
+    };
+
+    struct entry_t {
+        Kind kind;
+        uint8_t multi_i; // REMOTE_MULTI/FRAGMENT: index into the reply
+        msg::node_t target;
+        db_key_t index;
+        Table_t* table;
+        Future_t* future;
+        AbstractFuture* multi; // REMOTE_MULTI/FRAGMENT: holds the reply pkt
+    };
+
+    std::array<entry_t, CAPACITY> entries;
+    size_t n = 0;
     Communicator* comm;
+    PendingReleases* releases;
     uint32_t tid;
 
-    Undolog(Communicator* comm)
-        : comm(comm), tid(WorkerContext::get().tid) {}
+    Undolog(Communicator* comm, PendingReleases* releases)
+        : comm(comm), releases(releases), tid(WorkerContext::get().tid) {}
 
-    template <typename Table_t, typename Future_t>
     void add_write(Table_t* table, db_key_t index, Future_t* future) {
-        auto action = pool.allocate<Write<Table_t, Future_t>>(table, index, future);
-        actions.emplace_back(action);
+        push(entry_t{Kind::WRITE, 0, {}, index, table, future, nullptr});
     }
 
-    template <typename Table_t, typename Future_t>
     void add_read(Table_t* table, db_key_t index, Future_t* future) {
-        auto action = pool.allocate<Read<Table_t, Future_t>>(table, index, future);
-        actions.emplace_back(action);
+        push(entry_t{Kind::READ, 0, {}, index, table, future, nullptr});
     }
 
-    template <typename Tuple_t>
-    void add_remote_read(TupleFuture<Tuple_t>* future, msg::node_t target) {
-        auto action = pool.allocate<Remote<Tuple_t, AccessMode::READ>>(future, target);
-        actions.emplace_back(action);
+    void add_remote_read(Future_t* future, msg::node_t target) {
+        push(entry_t{Kind::REMOTE_READ, 0, target, 0, nullptr, future, nullptr});
     }
 
-    template <typename Tuple_t>
-    void add_remote_write(TupleFuture<Tuple_t>* future, msg::node_t target) {
-        auto action = pool.allocate<Remote<Tuple_t, AccessMode::WRITE>>(future, target);
-        actions.emplace_back(action);
+    void add_remote_write(Future_t* future, msg::node_t target) {
+        push(entry_t{Kind::REMOTE_WRITE, 0, target, 0, nullptr, future, nullptr});
     }
 
-    void commit(const timestamp_t ts) {
-        clear(ts);
+    // futures point into the TupleMultiGetRes, one entry per key it granted.
+    void add_remote_multi(AbstractFuture* future, Future_t** futures, msg::node_t target) {
+        auto res = future->get_pkt()->as<msg::TupleMultiGetRes>();
+        for (uint8_t i = 0; i < res->n; ++i) {
+            push(entry_t{Kind::REMOTE_MULTI, i, target, res->entries[i].rid, nullptr, futures[i], future});
+        }
     }
 
-    void rollback(const timestamp_t ts) {
-        clear(ts);
+    // same, for a shipped fragment. Its keys are logged back to back, clear() relies on that.
+    void add_remote_fragment(AbstractFuture* future, Future_t** futures, msg::node_t target) {
+        auto res = future->get_pkt()->as<msg::TupleFragmentRes>();
+        for (uint8_t i = 0; i < res->n; ++i) {
+            push(entry_t{Kind::REMOTE_FRAGMENT, i, target, res->entries[i].rid, nullptr, futures[i], future});
+        }
     }
 
-    void commit_last_n(const timestamp_t ts, const size_t n) {
-        clear_last_n(ts, n);
+    void commit(const timestamp_t ts) {
+        clear(ts, false);
     }
 
-    void rollback_last_n(const timestamp_t ts, const size_t n) {
-        clear_last_n(ts, n);
+    void rollback(const timestamp_t ts) {
+        clear(ts, true);
     }
 
 private:
-    void clear(const timestamp_t ts);
+    void push(const entry_t& entry) {
+        if (n == CAPACITY) [[unlikely]] {
+            throw std::runtime_error("undolog full");
+        }
+        entries[n++] = entry;
+    }
+
+    void clear(const timestamp_t ts, bool aborted);
 
-    void clear_last_n(const timestamp_t ts, const size_t n);
+    void release_local(const entry_t& entry, const timestamp_t ts);
+    void release_remote(const entry_t& entry, bool aborted);
 };
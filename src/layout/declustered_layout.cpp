@@ -1,6 +1,7 @@
 
 #include "layout/declustered_layout.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 static constexpr uint32_t NO_BLOCK = UINT32_MAX;
@@ -56,7 +57,7 @@ std::pair<bool, TupleLocation> DeclusteredLayout::get_location(db_key_t k) {
     // correct since we only get a single block.
 	info.first = tl.reg_array_idx < SLOTS_PER_SCHED_BLOCK;
     info.second = tl;
-    info.second.reg_array_idx = (SLOTS_PER_SCHED_BLOCK * this->block_num) + tl.reg_array_idx;
+    info.second.reg_array_idx = (SLOTS_PER_SCHED_BLOCK * this->block_num.load(std::memory_order_relaxed)) + tl.reg_array_idx;
 	return info;
 }
 
@@ -69,3 +70,21 @@ std::optional<db_key_t> DeclusteredLayout::rev_lookup(size_t reg_id, size_t reg_
         return it->second;
     }
 }
+
+/*	The n most frequent keys that do not go to the switch get a copy on every node. Like the
+	layout itself this only depends on the dist file, so all nodes agree without coordination. */
+void DeclusteredLayout::choose_replicas(size_t n) {
+	std::vector<std::pair<db_key_t, size_t>> by_freq = id_freq;
+	std::sort(by_freq.begin(), by_freq.end(), [](const std::pair<db_key_t, size_t>& pr1, const std::pair<db_key_t, size_t>& pr2){
+		return !TupleLocation::total_order_gt(pr1.second, pr1.first, pr2.second, pr2.first);
+	});
+	for (const auto& pr : by_freq) {
+		if (replicated.size() == n) {
+			break;
+		}
+		if (virt_map[pr.first].reg_array_idx >= SLOTS_PER_SCHED_BLOCK) {
+			replicated.insert(pr.first);
+		}
+	}
+	printf("Replicating %lu keys\n", replicated.size());
+}
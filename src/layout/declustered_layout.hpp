@@ -2,8 +2,10 @@
 
 #include "ee/defs.hpp"
 
+#include <atomic>
 #include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <ostream>
 #include <optional>
@@ -43,10 +45,21 @@ struct DeclusteredLayout {
 	DeclusteredLayout(std::vector<std::pair<db_key_t, size_t>>&& id_freq);
     std::pair<bool, TupleLocation> get_location(db_key_t k);
     std::optional<db_key_t> rev_lookup(size_t reg_id, size_t reg_idx);
+    void choose_replicas(size_t n);
+    bool is_replicated(db_key_t k) const {
+        return replicated.find(k) != replicated.end();
+    }
+    // like get_location(k).first, without inserting k.
+    bool is_hot(db_key_t k) const {
+        auto it = virt_map.find(k);
+        return it != virt_map.end() && it->second.reg_array_idx < SLOTS_PER_SCHED_BLOCK;
+    }
 
-	size_t block_num;
+	// the leader moves it while workers extract the next batch (USE_BATCH_PIPELINE), rebase_hot_ops fixes those up.
+	std::atomic<size_t> block_num;
 	// TODO: std::unordered_map is p slow, profile and see.
 	std::unordered_map<db_key_t, TupleLocation> virt_map;
     std::unordered_map<size_t, db_key_t> rev_by_reg[N_REGS];
 	std::vector<std::pair<db_key_t, size_t>> id_freq;
+	std::unordered_set<db_key_t> replicated;
 };
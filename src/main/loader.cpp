@@ -64,4 +64,8 @@ void load_txns(Config& config) {
     }
 
 	config.decl_layout = new DeclusteredLayout(std::move(id_freq));
+	// a replicated key costs a lock per node to write, only worth it when writes are rare.
+	if (USE_READ_REPLICAS && config.write_prob <= READ_REPLICA_MAX_WRITE_PCT && config.num_nodes <= READ_REPLICA_MAX_NODES) {
+		config.decl_layout->choose_replicas(READ_REPLICA_KEYS);
+	}
 }
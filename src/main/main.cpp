@@ -2,6 +2,7 @@
 #include "main/config.hpp"
 #include "ee/database.hpp"
 #include "ee/executor.hpp"
+#include "ee/cc_policy.hpp"
 #include "ee/table.hpp"
 
 #include <cassert>
@@ -36,6 +37,8 @@ int main(int argc, char** argv) {
 
     auto& config = Config::instance();
     config.parse_cli(argc, argv);
+	// wounded_ts is indexed by the tid in a timestamp.
+	assert(config.num_txn_workers <= cc::MAX_WORKERS);
 
 	// config should get the txns from the trace.
 	load_txns(config);
@@ -42,9 +42,12 @@ struct ClockTimestampFactory {
 };
 
 struct UniqueClockTimestampFactory {
-    using clock = std::chrono::high_resolution_clock;
+    using clock = std::chrono::system_clock;
+    using days = std::chrono::duration<int64_t, std::ratio<86400>>;
 
-    clock::time_point start = clock::now();
+    /*	Shared by every worker and, given synced clocks, every node (all start on the same UTC day),
+    	so wait-die/wound-wait compare the ages of any two txns. Leaves at least 2.25 days of ts. */
+    static inline const clock::time_point start = std::chrono::floor<days>(clock::now());
     uint64_t mask;
 
     UniqueClockTimestampFactory();
@@ -53,6 +56,14 @@ struct UniqueClockTimestampFactory {
         uint64_t ts = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
         return timestamp_t{(ts << 16) | mask}; // 2^48 ns -> 3.25781223 days
     }
+
+    // recover who issued a timestamp from the low 16 bits (see mask).
+    static uint32_t node_of(timestamp_t ts) {
+        return (ts >> 8) & 0xff;
+    }
+    static uint32_t tid_of(timestamp_t ts) {
+        return ts & 0xff;
+    }
 };
 
 